@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ascript/variable.h"
+
+#include <vector>
+#include <variant>
+#include <cstdint>
+
+namespace ascript {
+
+//!Homogeneous list of values with contiguous, typed storage.
+/**
+* The element type is set by the first value added and all others must
+* match it. Integers, doubles and booleans are kept unboxed in a vector of
+* their own; strings are kept as variables, so short ones stay inline. An
+* array cannot hold other arrays.
+*
+* Scripts reach arrays through variables, which share them by reference
+* count: copying such a variable copies the handle, never the elements.
+* Arrays are not synchronized, so the same array must not be modified from
+* several threads at once.
+*
+* Methods throw std::runtime_error on type mismatches and invalid indexes.
+*/
+class array {
+
+	public:
+
+	//!Returns the number of elements.
+	std::size_t             size() const;
+
+	//!Returns true if the array has no elements.
+	bool                    empty() const {return 0==size();}
+
+	//!Returns true once the element type is set, which happens when the
+	//!first value is added.
+	bool                    is_typed() const {return !std::holds_alternative<std::monostate>(storage);}
+
+	//!Returns the element type. Throws if it is not set yet.
+	variable::types         get_type() const;
+
+	//!Returns the element at the given index.
+	variable                get(std::size_t) const;
+
+	//!Replaces the element at the given index.
+	void                    set(std::size_t, const variable&);
+
+	//!Adds an element at the end.
+	void                    push(const variable&);
+
+	//!Removes the last element and returns it.
+	variable                pop();
+
+	//!Returns a new array with the elements in [begin, end).
+	array                   slice(std::size_t, std::size_t) const;
+
+	//!Makes room for the given number of elements, if typed.
+	void                    reserve(std::size_t);
+
+	private:
+
+	//!Sets the element type from the value if there is none yet, throws
+	//!if the value does not match it.
+	void                    check(const variable&);
+
+	//!Throws if the index is out of range.
+	void                    check_index(std::size_t) const;
+
+	std::variant<
+		std::monostate,
+		std::vector<std::uint8_t>,
+		std::vector<std::int64_t>,
+		std::vector<double>,
+		std::vector<variable>
+	>                       storage; //!<Elements, by type. Booleans are bytes.
+};
+
+}
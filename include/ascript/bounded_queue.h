@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <algorithm>
+
+namespace ascript {
+
+//!Fixed capacity queue that any number of threads can push to and pop from
+//!without locks.
+/**
+* Each cell carries a sequence number that tells producers and consumers
+* whether it is free or full for the current lap around the buffer, so
+* threads only compete for the head or tail counters. Capacity is rounded up
+* to a power of two, and is never less than two: with a single cell, a full
+* cell and the free one of the next lap carry the same sequence. Pushing to
+* a full queue or popping from an empty one fails right away instead of
+* waiting.
+*/
+template<typename T>
+class bounded_queue {
+
+	public:
+
+	//!Class constructor.
+	                            bounded_queue(std::size_t _capacity)
+		:cells(round_up(_capacity)), mask{cells.size()-1} {
+
+		for(std::size_t i=0; i<cells.size(); i++) {
+
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	                            bounded_queue(const bounded_queue&)=delete;
+	bounded_queue&              operator=(const bounded_queue&)=delete;
+
+	//!Returns the maximum number of items.
+	std::size_t                 capacity() const {return cells.size();}
+
+	//!Returns the number of items. While other threads push or pop it is
+	//!only an estimate, though never more than the capacity.
+	std::size_t                 size() const {
+
+		const std::size_t first=head.load(std::memory_order_acquire),
+		                  last=tail.load(std::memory_order_acquire);
+		//The tail read can fall behind a head that moved in between.
+		return last > first ? std::min(last-first, cells.size()) : 0;
+	}
+
+	//!Moves the item into the queue. Returns false if the queue is full, in 
+	//!which case the item is left untouched.
+	bool                        push(T& _item) {
+
+		std::size_t position=tail.load(std::memory_order_relaxed);
+		while(true) {
+
+			auto& current=cells[position & mask];
+			const std::size_t sequence=current.sequence.load(std::memory_order_acquire);
+			const auto difference=(std::ptrdiff_t)sequence-(std::ptrdiff_t)position;
+
+			if(0==difference) {
+
+				if(tail.compare_exchange_weak(position, position+1, std::memory_order_relaxed)) {
+
+					current.item=std::move(_item);
+					current.sequence.store(position+1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if(difference < 0) {
+
+				return false;
+			}
+			else {
+
+				position=tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	//!Moves the oldest item out of the queue. Returns false if empty.
+	bool                        pop(T& _item) {
+
+		std::size_t position=head.load(std::memory_order_relaxed);
+		while(true) {
+
+			auto& current=cells[position & mask];
+			const std::size_t sequence=current.sequence.load(std::memory_order_acquire);
+			const auto difference=(std::ptrdiff_t)sequence-(std::ptrdiff_t)(position+1);
+
+			if(0==difference) {
+
+				if(head.compare_exchange_weak(position, position+1, std::memory_order_relaxed)) {
+
+					_item=std::move(current.item);
+					current.sequence.store(position+mask+1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if(difference < 0) {
+
+				return false;
+			}
+			else {
+
+				position=head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	private:
+
+	struct cell {
+
+		std::atomic<std::size_t> sequence;
+		T                       item;
+	};
+
+	static std::size_t          round_up(std::size_t _value) {
+
+		std::size_t result=2;
+		while(result < _value) {
+
+			result*=2;
+		}
+
+		return result;
+	}
+
+	std::vector<cell>           cells;
+	const std::size_t           mask;
+	//!Producers and consumers get a cache line each.
+	alignas(64) std::atomic<std::size_t> head{0};
+	alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+}
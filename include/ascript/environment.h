@@ -3,32 +3,118 @@
 #include "ascript/interpreter.h"
 #include "ascript/host.h"
 #include "ascript/out_interface.h"
+#include "ascript/bounded_queue.h"
 
 #include <vector>
 #include <string>
+#include <queue>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
 
 namespace ascript {
 
+//!Measures how often runs found an interpreter ready in the pool.
+struct pool_stats {
+
+	std::size_t                 hits{0}, //!<Runs that took an interpreter from the pool.
+	                            misses{0}; //!<Runs that had to create one.
+};
+
+//!Histogram of latencies in power of two microsecond buckets.
+struct latency_histogram {
+
+	//!Number of buckets, the last one takes everything above.
+	static constexpr std::size_t    bucket_count=32;
+
+	//!Adds a latency.
+	void                            add(std::chrono::nanoseconds);
+
+	//!Returns the lower bound of a bucket, in microseconds.
+	static std::size_t              bucket_floor(std::size_t _bucket) {return _bucket ? std::size_t{1} << (_bucket-1) : 0;}
+
+	//!counts[0] holds latencies under a microsecond, counts[i] those in 
+	//![2^(i-1), 2^i) microseconds.
+	std::array<std::size_t, bucket_count> counts{};
+	std::size_t                     total{0}; //!<Number of latencies added.
+	std::chrono::nanoseconds        max{0}; //!<Largest latency added.
+};
+
+//!Stats collected by an environment.
+struct environment_stats {
+
+	deadline_stats              deadline; //!<Stats of all resume_until calls.
+	pool_stats                  pool; //!<Stats of the interpreter pool.
+	latency_histogram           submission_latency; //!<Time from submit to completion of run requests.
+};
+
+//!Outcome of a run request, passed to its completion callback.
+struct run_result {
+
+	std::size_t                 id; //!<Id of the interpreter, valid only if the result is a yield.
+	std::optional<return_value> result; //!<What the run returned, empty if it threw.
+	std::string                 error; //!<What the exception said, if it threw.
+};
+
+//!A request to run a function, that can be submitted from any thread.
+struct run_request {
+
+	std::string                 function; //!<Name of the function to run.
+	std::vector<variable>       arguments; //!<Arguments for the function.
+	//!Called from the thread that drains the requests once the function 
+	//!returns, yields or fails. Can be empty.
+	std::function<void(const run_result&)> on_completion;
+	std::chrono::steady_clock::time_point submitted{}; //!<Set by submit.
+};
+
+//!Result of an interpreter resumed by environment::resume_ready, signal
+//!or resume_completed.
+struct resumed_interpreter {
+
+	std::size_t                 id; //!<Id of the interpreter.
+	return_value                result{return_value::types::nothing}; //!<What resuming it returned, nothing if it threw.
+	std::string                 error{}; //!<What the exception said, if it threw. The interpreter is gone then.
+};
+
 //!Pre-packed environment for loading functions and running scripts.
 /**
 * Supports running several scripts at once (in case they yield). Interpreters
 * are removed as soon as they stop executing.
+*
+* Interpreters are identified by ids that pack a slot index in the lower 32
+* bits and the generation of that slot in the upper ones. Slots are reused 
+* once their interpreter is gone, but each reuse bumps the generation, so an
+* id that outlived its interpreter is detected as stale instead of reaching 
+* whatever interpreter took its slot.
+*
+* Finished interpreters are reset and kept in a pool (up to a limit) instead
+* of being destroyed, so later runs reuse them along with all the memory they
+* had already claimed for stacks and symbols.
+*
+* Nothing here is thread-safe, except for submit: other threads can hand run
+* requests to the environment through a lock-free queue, which the owning
+* thread empties with drain_submissions at a point of its choice.
 */
 class environment {
 
 	public:
 
-	//!Class constructor.
-	                            environment(host&, out_interface&);
+	//!Class constructor. The last parameter is the capacity of the queue
+	//!of submitted run requests.
+	                            environment(host&, out_interface&, std::size_t=1024);
 
 	//!Returns the number of current (yielding) interpreters.
-	std::size_t                 size() const {return interpreters.size();}
+	std::size_t                 size() const {return live_count;}
 
 	//!returns true if a function with that name is loaded.
 	bool                        has_function(const std::string& _funcname) {return functions.count(_funcname);}
 
-	//!Removes all pending interpreters and resets the id counter. Does not remove functions.
-	void                        clear() {interpreters.clear(); counter=0;}
+	//!Removes all pending interpreters. Their ids become stale. Does not remove functions.
+	void                        clear();
 
 	//!Loads functions from a file.
 	void                        load(const std::string&);
@@ -39,11 +125,19 @@ class environment {
 	//!Unloads a function by name.
 	void                        unload(const std::string&);
 
-	//!Pauses all pausable interpreters. Will not throw.
-	void                        pause();
+	//!Pauses all timed yields. Will not throw.
+	/**
+	* Time stops for all interpreters in the environment until unpause is 
+	* called, so both calls take constant time. Resuming a timed yield while 
+	* paused returns the yield value, even if its time was up before pausing.
+	*/
+	void                        pause() {clock->pause();}
+
+	//!Un pauses all timed yields. Will not throw.
+	void                        unpause() {clock->unpause();}
 
-	//!Un pauses all pausable interpreters. Will not throw.
-	void                        unpause();
+	//!Returns true if the environment is paused.
+	bool                        is_paused() const {return clock->is_paused();}
 
 	//!Runs a function.
 	return_value                run(const std::string&, const std::vector<variable>&);
@@ -51,12 +145,130 @@ class environment {
 	//!Runs a function, stores the id of the executing interpreter.
 	return_value                run(const std::string&, const std::vector<variable>&, std::size_t&);
 
+	//!Runs a function, preempting it once it runs out of budget.
+	return_value                run(const std::string&, const std::vector<variable>&, instruction_budget);
+
+	//!Runs a function, preempting it once it runs out of budget. Stores the 
+	//!id of the executing interpreter so it can be resumed.
+	return_value                run(const std::string&, const std::vector<variable>&, std::size_t&, instruction_budget);
+
 	//!Resumes the interpreter with the given id.
 	return_value                resume(std::size_t);
 
+	//!Resumes the interpreter with the given id, preempting it once it runs
+	//!out of budget.
+	return_value                resume(std::size_t, instruction_budget);
+
+	//!Resumes the interpreter with the given id, preempting it once the 
+	//!deadline passes. See interpreter::resume_until.
+	return_value                resume_until(std::size_t, std::chrono::steady_clock::time_point);
+
+	//!Queues a run request. Can be called from any thread. Returns false, 
+	//!leaving the request untouched, if the queue is full. The arguments 
+	//!are replaced by clones (see variable::clone), so the caller can keep
+	//!using the arrays, structs, maps and builders it passed.
+	bool                        submit(run_request&);
+
+	//!Runs queued requests, up to the given number, and calls their 
+	//!completion callbacks. Must be called from the owning thread. Returns 
+	//!the number of requests run.
+	/**
+	* Requests that throw do not stop the rest: the error goes to the 
+	* completion callback.
+	*/
+	std::size_t                 drain_submissions(std::size_t=std::numeric_limits<std::size_t>::max());
+
+	//!Returns the number of queued requests. While other threads submit 
+	//!it is only an estimate.
+	std::size_t                 get_submission_count() const {return submissions->size();}
+
+	//!Runs the same function once per argument set and stores the results
+	//!in the last parameter, in the same order as the argument sets.
+	/**
+	* The function is looked up once and each interpreter runs the argument
+	* sets back to back, which saves the per-run setup of run. Sets that 
+	* fail do not stop the rest: their result is empty and the error is 
+	* stored instead. Sets that yield keep their interpreter, whose id is 
+	* stored in the result so it can be resumed as usual.
+	*
+	* The last parameter spreads the sets across that many threads, each with
+	* its own interpreter. In that case the host and the output facility are
+	* called concurrently and must be thread-safe, and the sets are cloned 
+	* (see variable::clone) so threads never share an array, struct, map or
+	* builder. The call blocks until all threads are done.
+	*/
+	void                        run_batch(const std::string&, const std::vector<std::vector<variable>>&, std::vector<run_result>&, std::size_t=1);
+
+	//!Resumes all interpreters whose timed yield has expired, in order of 
+	//!expiration, and returns what each of them returned.
+	/**
+	* Only timed yields are considered, interpreters yielding with a plain 
+	* "yield" must still be resumed by id. Does nothing while paused. 
+	* Interpreters paused one by one through get_interpreter are skipped until 
+	* they are resumed by id. Interpreters that throw do not stop the rest:
+	* they are removed and their entry carries the error instead of a value.
+	*/
+	std::vector<resumed_interpreter> resume_ready();
+
+	//!Same as resume_ready, giving each interpreter the same budget.
+	std::vector<resumed_interpreter> resume_ready(instruction_budget);
+
+	//!Resumes all interpreters waiting for the given event with "yield 
+	//!until", in the order they started waiting, and returns what each of 
+	//!them returned.
+	/**
+	* Waiting interpreters are kept in a list per event, so those waiting for
+	* other events (or for nothing yet) cost nothing. Interpreters that wait
+	* for the same event again are left for the next signal. Interpreters
+	* that throw are removed and their entry carries the error.
+	*/
+	std::vector<resumed_interpreter> signal(const std::string&);
+
+	//!Resumes all interpreters whose host queries (see 
+	//!host::host_query_async) have been completed since the last call, in 
+	//!order of completion, and returns what each of them returned.
+	/**
+	* Queries can be completed from any thread, but this must be called from
+	* the owning thread. Interpreters waiting for queries still in flight are
+	* not touched. Interpreters that throw (a failed query makes its script
+	* fail) are removed and their entry carries the error.
+	*/
+	std::vector<resumed_interpreter> resume_completed();
+
+	//!Sets the time source for timed yields in all current and future 
+	//!interpreters. The time source must outlive the environment.
+	void                        set_time_source(const time_source&);
+
+	//!Sets the mailbox used by "post" in all interpreters started from now
+	//!on, null to forbid posting. The mailbox must outlive the environment.
+	void                        set_mailbox(mailbox * _mailbox) {mailbox_ptr=_mailbox;}
+
+	//!Sets what integer arithmetic does on overflow in all 
+	//!interpreters started from now on.
+	void                        set_overflow_policy(overflow_policy _policy) {overflow=_policy;}
+
+	//!Returns what integer arithmetic does on overflow.
+	overflow_policy             get_overflow_policy() const {return overflow;}
+
+	//!Sets how many finished interpreters are kept for later runs. Extra
+	//!ones are destroyed right away.
+	void                        set_pool_limit(std::size_t);
+
+	//!Returns how many finished interpreters can be kept for later runs.
+	std::size_t                 get_pool_limit() const {return pool_limit;}
+
+	//!Returns how many finished interpreters are ready for later runs.
+	std::size_t                 get_pool_size() const {return pool.size();}
+
+	//!Returns the stats collected so far.
+	const environment_stats&    get_stats() const {return stats;}
+
 	//!Returns a vector with the identifiers of yielding interpreters.
 	std::vector<std::size_t>    get_yield_ids() const;
 
+	//!Returns true if the id belongs to a current (yielding) interpreter.
+	bool                        has_interpreter(std::size_t _id) const {return nullptr!=find(_id);}
+
 	//!Returns a reference to the interpreter with the given id, for finer control.
 	interpreter&                get_interpreter(std::size_t);
 
@@ -70,18 +282,95 @@ class environment {
 		std::size_t             id;
 		std::string             function;
 		ascript::interpreter    interpreter;
+		time_source::time_point scheduled{time_source::time_point::min()}; //!<Release time of the last timer set.
+		std::string             waiting_on{}; //!<Event it was last added as a waiter for.
+		std::shared_ptr<pending_query> watching{}; //!<Host query whose completion it listens to.
+	};
+
+	//!A timed yield waiting in the timer queue.
+	struct timer {
+
+		time_source::time_point release_time;
+		std::size_t             id;
+
+		bool                    operator>(const timer& _other) const {return release_time > _other.release_time;}
 	};
 
+	//!Ids of interpreters whose host queries are done, filled from the
+	//!threads that complete them. Queries only keep a weak pointer to it, so
+	//!completing one after the environment is gone does nothing.
+	struct completed_queries {
+
+		std::mutex              mutex;
+		std::vector<std::size_t> ids;
+	};
+
+	//!A place for an interpreter. Packs are heap allocated so they never 
+	//!move, regardless of what happens to the rest of slots.
+	struct slot {
+
+		std::uint32_t           generation{1};
+		std::unique_ptr<pack>   content;
+	};
+
+	//!Returns the pack with the given id, nullptr if there is none.
+	pack *                      find(std::size_t);
+	const pack *                find(std::size_t) const;
+
+	//!Returns the pack with the given id, throws if there is none.
+	pack&                       get_pack(std::size_t);
+	const pack&                 get_pack(std::size_t) const;
+
+	//!Returns an interpreter ready to run, taken from the pool if possible.
+	std::unique_ptr<pack>       take_pack(const std::string&);
+
+	//!Gives the interpreter the time source, mailbox and functions of the
+	//!environment.
+	void                        prepare(pack&);
+
+	//!Puts the pack in a free slot and gives it its id.
+	pack&                       install(std::unique_ptr<pack>);
+
+	//!Returns the pack to the pool if there is room, destroys it otherwise.
+	void                        release(std::unique_ptr<pack>);
+
+	//!Adds a timer for the interpreter if it is in a new timed yield.
+	void                        schedule(pack&);
+
+	//!Resumes the interpreter for resume_ready, signal and resume_completed.
+	//!If it throws, it is erased and the error goes in the result.
+	resumed_interpreter         resume_entry(std::size_t, instruction_budget);
+
 	void                        erase(std::size_t); 
 
-	using function_table=std::map<std::string, ascript::function>;
+	using function_map=std::map<std::string, ascript::function>;
+
+	//!Returns the shared table of loaded functions, building it if needed.
+	const std::shared_ptr<const ascript::function_table>& get_function_table();
 
 	host&                       host_instance;
 	out_interface&              outfacility;
 
-	std::size_t                 counter{0};
-	function_table              functions;
-	std::vector<pack>           interpreters;
+	//!Time source of all interpreters, pausing it pauses them all.
+	std::unique_ptr<pausable_time_source> clock;
+	function_map                functions;
+	//!Index shared by all interpreters, null when it needs rebuilding.
+	std::shared_ptr<const ascript::function_table> shared_functions;
+	std::vector<slot>           slots;
+	std::vector<std::uint32_t>  free_slots; //!<Indexes of empty slots.
+	std::size_t                 live_count{0}; //!<Number of slots in use.
+	std::priority_queue<timer, std::vector<timer>, std::greater<timer>> timers;
+	//!Ids of interpreters waiting for each event.
+	std::unordered_map<std::string, std::vector<std::size_t>> waiters;
+	mailbox *                   mailbox_ptr{nullptr};
+	overflow_policy             overflow{overflow_policy::wrap};
+	//!Run requests from other threads.
+	std::unique_ptr<bounded_queue<run_request>> submissions;
+	std::shared_ptr<completed_queries> completions;
+	//!Finished interpreters, reset and ready to run again.
+	std::vector<std::unique_ptr<pack>> pool;
+	std::size_t                 pool_limit{64};
+	environment_stats           stats;
 };
 
 }
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "instructions.h"
+
+#include <vector>
+#include <string>
+#include <string_view>
+
+namespace ascript {
+
+//!Immutable index of functions by name.
+/**
+* Built once, then shared by as many interpreters as needed so none of them
+* has to index the functions on its own. Names are stored in a flat open 
+* addressing table (linear probing, at most half full), so a lookup hashes 
+* the name once and usually touches a single entry. Functions are not owned
+* by the table and must outlive it.
+*/
+class function_table {
+
+	public:
+
+	//!Class constructor. Throws if two functions share a name.
+	                            function_table(const std::vector<const function *>&);
+
+	//!Returns the function with the given name, nullptr if there is none.
+	const function *            find(std::string_view) const;
+
+	//!Returns true if a function with the given name is indexed.
+	bool                        has(std::string_view _name) const {return nullptr!=find(_name);}
+
+	//!Returns the number of indexed functions.
+	std::size_t                 size() const {return count;}
+
+	private:
+
+	struct entry {
+
+		std::size_t             hash{0};
+		const function *        fn{nullptr}; //!<nullptr for empty entries.
+	};
+
+	std::vector<entry>          entries; //!<Size is always a power of two.
+	std::size_t                 mask{0}, //!<Size of entries minus one.
+	                            count{0};
+};
+
+}
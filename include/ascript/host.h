@@ -2,10 +2,12 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 namespace ascript {
 
 struct variable;
+class pending_query;
 
 
 //!This interface defines what a host should be able to do.
@@ -34,6 +36,12 @@ class host {
 	//!Must send a query to the host about its state that can be solved to a variable.
 	virtual variable            host_query(const std::vector<variable>&) const =0;
 
+	//!Starts a query that can be answered later, returning a handle that the
+	//!host completes once the answer is ready, possibly from another thread.
+	//!The script waits as if it had yielded. By default, the query is 
+	//!answered right away through host_query.
+	virtual std::shared_ptr<pending_query> host_query_async(const std::vector<variable>&) const;
+
 	//!Must add the given value to the symbol table or throw host_error if the
 	//!symbol is already defined.
 	virtual void                host_add(const std::string&, variable)=0;
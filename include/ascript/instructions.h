@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ascript/variable.h"
+#include "ascript/symbol_table.h"
 
 #include <string>
 #include <vector>
@@ -8,10 +9,13 @@
 #include <memory>
 #include <ostream>
 #include <optional>
+#include <iterator>
+#include <string_view>
 
 namespace ascript {
 
 struct run_context;
+struct struct_type;
 
 //!base class for all script instructions.
 /**
@@ -113,6 +117,67 @@ struct instruction_host_do:instruction_procedure {
 	void                    run(run_context&)const;
 };
 
+//!instruction to replace an element of an array [array, index, value].
+struct instruction_array_set:instruction_procedure {
+
+                            instruction_array_set(int _line_number):instruction_procedure{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+};
+
+//!instruction to add values at the end of an array [array, value, value...].
+struct instruction_array_push:instruction_procedure {
+
+                            instruction_array_push(int _line_number):instruction_procedure{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+};
+
+//!instruction to set a field of a struct [struct, type.field, value]. The
+//!field is resolved to its index when parsing.
+struct instruction_struct_set:instruction_procedure {
+
+                            instruction_struct_set(int _line_number, const std::shared_ptr<const struct_type>& _type, std::size_t _field):instruction_procedure{_line_number}, type{_type}, field{_field}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	std::shared_ptr<const struct_type> type; //!<Type the struct must be of.
+	std::size_t             field; //!<Index of the field.
+};
+
+//!instruction to set the value of a key in a map [map, key, value].
+struct instruction_map_set:instruction_procedure {
+
+                            instruction_map_set(int _line_number):instruction_procedure{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+};
+
+//!instruction to remove keys from a map [map, key, key...].
+struct instruction_map_erase:instruction_procedure {
+
+                            instruction_map_erase(int _line_number):instruction_procedure{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+};
+
+//!instruction to add values at the end of a string builder [builder, value,
+//!value...].
+struct instruction_builder_append:instruction_procedure {
+
+                            instruction_builder_append(int _line_number):instruction_procedure{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+};
+
+//!instruction to send a message to the mailbox: a key, a function name and
+//!its arguments.
+struct instruction_post:instruction_procedure {
+
+                            instruction_post(int _line_number):instruction_procedure{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+};
+
 //Functions.
 
 //!Instruction that generates a value, for assignment purposes. It looks like
@@ -182,6 +247,70 @@ struct instruction_substract:instruction_function {
 	variable                evaluate(run_context&) const;
 };
 
+//!instruction to multiply n numeric parameters
+struct instruction_multiply:instruction_function {
+
+                            instruction_multiply(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to divide the first numeric parameter by the rest
+struct instruction_divide:instruction_function {
+
+                            instruction_divide(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to take the remainder of dividing the first numeric parameter
+//!by the rest
+struct instruction_modulo:instruction_function {
+
+                            instruction_modulo(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction returning the lowest of n numeric parameters
+struct instruction_min:instruction_function {
+
+                            instruction_min(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction returning the highest of n numeric parameters
+struct instruction_max:instruction_function {
+
+                            instruction_max(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction returning the absolute value of a numeric parameter
+struct instruction_abs:instruction_function {
+
+                            instruction_abs(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to limit a numeric value to a range [value, lowest, highest]
+struct instruction_clamp:instruction_function {
+
+                            instruction_clamp(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
 //!instruction to concatenate string parameters
 struct instruction_concatenate:instruction_function {
 
@@ -191,6 +320,233 @@ struct instruction_concatenate:instruction_function {
 	variable                evaluate(run_context&) const;
 };
 
+//!instruction returning the length of a string, in bytes.
+struct instruction_string_length:instruction_function {
+
+                            instruction_string_length(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction returning part of a string [string, begin, end], end being
+//!optional.
+struct instruction_substring:instruction_function {
+
+                            instruction_substring(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction returning where a string is found in another, -1 if not
+//![string, needle, from], from being optional.
+struct instruction_string_find:instruction_function {
+
+                            instruction_string_find(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction returning true if a string starts with another [string, prefix].
+struct instruction_starts_with:instruction_function {
+
+                            instruction_starts_with(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction comparing two strings, returns -1, 0 or 1 [first, second].
+struct instruction_string_compare:instruction_function {
+
+                            instruction_string_compare(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction converting a string or double to an integer [value, default],
+//!default being optional.
+struct instruction_to_int:instruction_function {
+
+                            instruction_to_int(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction converting a string or integer to a double [value, default],
+//!default being optional.
+struct instruction_to_double:instruction_function {
+
+                            instruction_to_double(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction converting a boolean, integer or double to a string.
+struct instruction_to_string:instruction_function {
+
+                            instruction_to_string(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to write values into a format string, replacing each {} with
+//!the next value [format, value, value...].
+struct instruction_format:instruction_function {
+
+                            instruction_format(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to build a new string builder, appending the given values.
+struct instruction_builder:instruction_function {
+
+                            instruction_builder(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction returning the string in a builder, which is emptied [builder].
+struct instruction_builder_freeze:instruction_function {
+
+                            instruction_builder_freeze(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!returns true if all of the parameters are arrays.
+struct instruction_is_array:instruction_function {
+
+                            instruction_is_array(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to build a new array with the given values, all of the same type.
+struct instruction_array:instruction_function {
+
+                            instruction_array(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to return the number of elements of an array.
+struct instruction_array_size:instruction_function {
+
+                            instruction_array_size(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to return an element of an array [array, index].
+struct instruction_array_get:instruction_function {
+
+                            instruction_array_get(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to remove the last element of an array and return it.
+struct instruction_array_pop:instruction_function {
+
+                            instruction_array_pop(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to copy a range of an array into a new one [array, begin, end].
+struct instruction_array_slice:instruction_function {
+
+                            instruction_array_slice(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!returns true if all of the parameters are maps.
+struct instruction_is_map:instruction_function {
+
+                            instruction_is_map(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to build a new map from keys and values [key, value, key, value...].
+struct instruction_map:instruction_function {
+
+                            instruction_map(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to return the number of entries of a map.
+struct instruction_map_size:instruction_function {
+
+                            instruction_map_size(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to return the value of a key in a map [map, key], or the
+//!given default when the key is missing [map, key, default].
+struct instruction_map_get:instruction_function {
+
+                            instruction_map_get(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!returns true if the map has all of the given keys [map, key, key...].
+struct instruction_map_has:instruction_function {
+
+                            instruction_map_has(int _line_number):instruction_function{_line_number}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+};
+
+//!instruction to build a new struct with the values of its fields, in order,
+//!or with the default values if none are given.
+struct instruction_struct_new:instruction_function {
+
+                            instruction_struct_new(int _line_number, const std::shared_ptr<const struct_type>& _type):instruction_function{_line_number}, type{_type}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+	std::shared_ptr<const struct_type> type; //!<Type of the new struct.
+};
+
+//!instruction to read a field of a struct [struct, type.field]. The field
+//!is resolved to its index when parsing.
+struct instruction_struct_get:instruction_function {
+
+                            instruction_struct_get(int _line_number, const std::shared_ptr<const struct_type>& _type, std::size_t _field):instruction_function{_line_number}, type{_type}, field{_field}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                evaluate(run_context&) const;
+	std::shared_ptr<const struct_type> type; //!<Type the struct must be of.
+	std::size_t             field; //!<Index of the field.
+};
+
 //!instruction to ask a host if it holds a symbol on its table.
 struct instruction_host_has:instruction_function {
 
@@ -254,6 +610,16 @@ struct instruction_host_query:instruction_function {
 	variable                evaluate(run_context&) const;
 };
 
+//!instruction to start an asynchronous host query. Works like a function 
+//!call: the script waits until the query is done and the answer is left in
+//!the return register.
+struct instruction_host_query_async:instruction_procedure {
+
+                            instruction_host_query_async(int _line_number, const std::vector<variable>& _arguments):instruction_procedure{_line_number}{arguments=_arguments;}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // Language instructions.
 
@@ -311,6 +677,16 @@ struct instruction_yield:instruction {
 	variable                yield_ms;
 };
 
+//!instruction to yield until the host signals an event. The script will 
+//!remain stopped until the event is signaled.
+struct instruction_yield_until:instruction {
+
+                            instruction_yield_until(int _line_number, const variable& _event):instruction{_line_number}, event{_event}{}
+	void                    format_out(std::ostream&) const;
+	void                    run(run_context&)const;
+	variable                event; //!<Name of the event, or a symbol solving to it.
+};
+
 //!instruction to break of a loop.
 struct instruction_break:instruction {
 
@@ -368,7 +744,19 @@ struct block {
 struct parameter {
 
 	std::string                                 name;
-	enum class types{integer, decimal, boolean, string, any} type;
+	enum class types{integer, decimal, boolean, string, array, structure, map, builder, any} type;
+};
+
+//!a struct type definition, which is a name and a list of fields. Scripts 
+//!refer to fields as type.field and these are resolved to indexes when 
+//!parsing.
+struct struct_type {
+
+	std::string                                 name;
+	std::vector<parameter>                      fields;
+
+	//!Returns the index of the field with the given name, -1 if none.
+	int                                         find(std::string_view) const;
 };
 
 //!a script definition. A script is made up of a list of blocks, whose 
@@ -381,12 +769,74 @@ struct function {
 	std::vector<parameter>                      parameters;
 };
 
-//!Returns a vector of variables from the given vector of variables, resolving
-//!any symbols.
-std::vector<variable>   solve(const std::vector<variable>&, const std::map<std::string, variable>&, int);
+//!returns the given variable or, if it's a symbol, the value it resolves to 
+//!in the symbol table. Nothing is copied.
+const variable&         solve(const variable&, const symbol_table&, int);
 
-//!returns a variable from the given variable, resolving it if it's a symbol.
-variable                solve(const variable&, const std::map<std::string, variable>&, int);
+//!Arguments of an instruction with all symbols resolved.
+/**
+* Solved arguments do not hold values, but point to the literals stored in the
+* instruction or to the values in the symbol table, so they must not outlive
+* neither. Up to inline_capacity arguments are solved without any heap
+* allocation. Instructions that need actual copies (host calls, function 
+* calls) can materialize them into a vector with copy_to.
+*/
+class solved_arguments {
+
+	public:
+
+	//!Maximum number of arguments that can be solved without allocating.
+	static constexpr std::size_t    inline_capacity=8;
+
+	//!Iterator over solved arguments, dereferences to the variables themselves.
+	class const_iterator {
+
+		public:
+
+		using iterator_category=std::forward_iterator_tag;
+		using value_type=variable;
+		using difference_type=std::ptrdiff_t;
+		using pointer=const variable *;
+		using reference=const variable&;
+
+		                    const_iterator(const variable * const * _ptr):ptr{_ptr} {}
+		reference           operator*() const {return **ptr;}
+		pointer             operator->() const {return *ptr;}
+		const_iterator&     operator++() {++ptr; return *this;}
+		const_iterator      operator++(int) {auto copy=*this; ++ptr; return copy;}
+		bool                operator==(const const_iterator& _other) const {return ptr==_other.ptr;}
+		bool                operator!=(const const_iterator& _other) const {return ptr!=_other.ptr;}
+
+		private:
+
+		const variable * const * ptr;
+	};
+
+	//!Class constructor, solves the arguments against the symbol table.
+	                        solved_arguments(const std::vector<variable>&, const symbol_table&, int);
+	                        solved_arguments(const solved_arguments&)=delete;
+	solved_arguments&       operator=(const solved_arguments&)=delete;
+
+	//!Returns the number of arguments.
+	std::size_t             size() const {return count;}
+	//!Returns the argument at the given index, unchecked.
+	const variable&         operator[](std::size_t _index) const {return *(data()[_index]);}
+	//!Returns the first argument, unchecked.
+	const variable&         front() const {return *(data()[0]);}
+	const_iterator          begin() const {return {data()};}
+	const_iterator          end() const {return {data()+count};}
+
+	//!Copies the values into the given vector, which is cleared first.
+	void                    copy_to(std::vector<variable>&) const;
+
+	private:
+
+	const variable * const * data() const {return overflow.size() ? overflow.data() : storage;}
+
+	const variable *        storage[inline_capacity];
+	std::vector<const variable *> overflow;
+	std::size_t             count{0};
+};
 
 //!output stream operator for an instruction, for debug purposes.
 std::ostream& operator<<(std::ostream&, const instruction&);
@@ -4,19 +4,49 @@
 #include "run_context.h"
 #include "return_value.h"
 #include "out_interface.h"
+#include "time_source.h"
+#include "function_table.h"
 
 #include <vector>
 #include <string>
 #include <chrono>
+#include <limits>
+#include <memory>
 
 namespace ascript {
 
+//!Maximum number of instructions an interpreter can execute on a single call
+//!to run or resume before being preempted.
+struct instruction_budget {
+
+	std::size_t                     instructions; //!<Number of instructions.
+
+	//!Returns a budget that never runs out.
+	static instruction_budget       unlimited() {return {std::numeric_limits<std::size_t>::max()};}
+};
+
+//!Measures how well executions with a deadline kept to it.
+struct deadline_stats {
+
+	//!Adds the result of an execution that returned control at the given 
+	//!time point.
+	void                            add(std::chrono::steady_clock::time_point _deadline, std::chrono::steady_clock::time_point _returned, bool _preempted);
+
+	std::size_t                     runs{0}, //!<Number of executions with a deadline.
+	                                preemptions{0}, //!<Number of those that were preempted by the deadline.
+	                                overshoots{0}; //!<Number of those that returned control after the deadline.
+	std::chrono::nanoseconds        last_overshoot{0}, //!<Overshoot of the last execution that overshot.
+	                                max_overshoot{0}, //!<Largest overshoot.
+	                                total_overshoot{0}; //!<Sum of all overshoots.
+};
+
 //!This is a stack... the interpreter keeps a list of these 
 /**
 * Each stack corresponds with a block, keeping track of the function the block
 * belongs to, the block index (in the blocks vector) and the next instruction
-* index to be executed. Of course, there's also the context, which contains 
-* symbol tables and exchange values.
+* index to be executed. Of course, there's also the symbol table. Exchange 
+* values between instructions and the interpreter are not kept here but in
+* the interpreter-wide run_context.
 **/
 struct stack {
 
@@ -26,8 +56,8 @@ struct stack {
 	int                             block_index,
 	//!index of the next instruction to be executed.
 	                                instruction_index;
-	//!data context.
-	run_context                     context;
+	//!symbol table for this stack.
+	ascript::symbol_table           symbol_table;
 };
 
 //!The interpreter.
@@ -52,12 +82,35 @@ class interpreter {
 	//!Runs a named function that should have been added before.
 	return_value        run(host&, out_interface&, const std::string&, const std::vector<variable>&);
 
+	//!Directly runs a function object, preempting it once the budget runs out.
+	/**
+	* Preemption works just like a yield statement: the returned value is a 
+	* yield and the execution can be continued with resume. The return value
+	* and is_preempted can tell both cases apart.
+	*/
+	return_value        run(host&, out_interface&, const function&, const std::vector<variable>&, instruction_budget);
+
+	//!Runs a named function, preempting it once the budget runs out.
+	return_value        run(host&, out_interface&, const std::string&, const std::vector<variable>&, instruction_budget);
+
 	//!Resumes a yielding execution. Throws if the execution is not stopped.
 	/**
 	* Returns a yield value if a timed yield has yet to finish or is paused.
 	*/
 	return_value        resume();
 
+	//!Resumes a yielding execution, preempting it once the budget runs out.
+	return_value        resume(instruction_budget);
+
+	//!Resumes a yielding execution, preempting it once the deadline passes.
+	/**
+	* The clock is only checked at loop iterations and function calls, so 
+	* instructions in between (host calls, for example) can make the 
+	* interpreter return after the deadline. This overshoot is measured in 
+	* the deadline stats.
+	*/
+	return_value        resume_until(std::chrono::steady_clock::time_point);
+
 	//!Sets a pause point for timed yields, indicating that yield time limits must be posponed.
 	/**
 	*A call to "unpause" will restore the previous status. Will throw if the interpreter is not yielding in a timed mannner.
@@ -79,27 +132,82 @@ class interpreter {
 	//!Returns true if the interpreter is yielding.
 	bool                is_yield() const {return yield_signal;}
 
+	//!Returns true if the interpreter is yielding because it was preempted
+	//!instead of because of a yield statement.
+	bool                is_preempted() const {return is_yield() && preempted_signal;}
+
 	//!Returns true if the interpreter is yielding with a time lock.
-	bool                is_timed_yield() const {return is_yield() && yield_release_time!=std::chrono::system_clock::time_point::min();}
+	bool                is_timed_yield() const {return is_yield() && yield_release_time!=time_source::time_point::min();}
+
+	//!Returns true if the interpreter is yielding until an event is signaled.
+	bool                is_event_yield() const {return is_yield() && !awaited_event.empty();}
+
+	//!Returns true if the interpreter is yielding until a host query started
+	//!with host_query_async is done.
+	bool                is_query_yield() const {return is_yield() && nullptr!=context.pending_query;}
+
+	//!Returns the host query the interpreter waits for, null if none.
+	const std::shared_ptr<pending_query>& get_pending_query() const {return context.pending_query;}
+
+	//!Returns the event the interpreter waits for, empty if it does not.
+	const std::string&  get_awaited_event() const {return awaited_event;}
+
+	//!Tells the interpreter that an event happened. Returns true if it was 
+	//!waiting for it, in which case the next resume continues the script.
+	/**
+	* Until notified, resuming an interpreter that waits for an event returns
+	* the yield value without running anything.
+	*/
+	bool                notify(const std::string&);
 
 	//!Returns true if the interpreted is in a timed yield and paused.
-	bool                is_paused() const {return is_timed_yield() && yield_pause_time!=std::chrono::system_clock::time_point::min();}
+	bool                is_paused() const {return is_timed_yield() && yield_pause_time!=time_source::time_point::min();}
+
+	//!Returns the accumulated stats of calls to resume_until.
+	const deadline_stats& get_deadline_stats() const {return stats;}
 
 	//!Returns the number of milliseconds until a time yield ends. Throws if
 	//!there's no yield, returns 0 if not a timed yield. The value cannot be 
 	//!trusted if the interpreter is paused!
 	int                 get_yield_ms_left() const;
 
+	//!Returns the point in time in which a timed yield releases, min if 
+	//!there's no timed yield.
+	time_source::time_point get_yield_release_time() const {return is_timed_yield() ? yield_release_time : time_source::time_point::min();}
+
+	//!Sets the time source for timed yields. The time source must outlive 
+	//!the interpreter. Changing it during a timed yield is not a good idea.
+	void                set_time_source(const time_source& _source) {clock=&_source;}
+
 	//!Returns true if a function with the given name can be found;
 	bool                has_function(const std::string& _funcname) const {
 
-		return functions.count(_funcname);
+		return nullptr!=find_function(_funcname);
 	}
 
+	//!Sets the mailbox for messages sent with "post", null to forbid them.
+	//!The mailbox must outlive the interpreter.
+	void                set_mailbox(mailbox * _mailbox) {context.mailbox_ptr=_mailbox;}
+
+	//!Sets what integer arithmetic does on overflow. Wrapping
+	//!around is the default.
+	void                set_overflow_policy(overflow_policy _policy) {context.overflow=_policy;}
+
+	//!Returns what integer arithmetic does on overflow.
+	overflow_policy     get_overflow_policy() const {return context.overflow;}
+
+	//!Sets a table of functions shared with other interpreters. Functions
+	//!added with add_function are looked up first.
+	void                set_function_table(std::shared_ptr<const function_table> _table) {shared_functions=std::move(_table);}
+
 	//!Removes a function by name. Will throw if a function by the given name
-	//!does not exist.
+	//!does not exist or if it belongs to the shared function table.
 	void                remove_function(const std::string&);
 
+	//!Returns the interpreter to the state of a newly created one, except 
+	//!for the time source. Memory is kept so it can be used again.
+	void                reset();
+
 	//!Adds a function. The function object MUST outlive the interpreter. 
 	//!This includes the use of the parser, that must not go out of scope. Will
 	//!throw if a function by that name exists. Notice that the function 
@@ -108,26 +216,46 @@ class interpreter {
 
 	private:
 
+	//!Returns the function with the given name, nullptr if there is none.
+	const function *    find_function(std::string_view) const;
+
 	//!Main loop function. There are no recursive calls to this function.
 	return_value        interpret();
 
-	//!Prepares a symbol table for a function call to be called (makes parameters available).
-	std::map<std::string, variable> prepare_symbol_table(const function&, const std::vector<variable>&, int);
+	//!Common part to all resume calls.
+	return_value        continue_execution(instruction_budget, std::chrono::steady_clock::time_point);
+
+	//!Stops the execution so it can be resumed later.
+	return_value        preempt();
+
+	//!Returns true if there's a deadline and it has passed.
+	bool                is_past_deadline() const;
+
+	//!Fills a symbol table for a function call to be called (makes parameters available).
+	void                prepare_symbol_table(ascript::symbol_table&, const function&, const std::vector<variable>&, int);
+	//!Returns an empty symbol table, recycled if possible.
+	ascript::symbol_table get_spare_table();
 	//!Pushes a new stack.
 	void                push_stack(const function *, int);
 	//!Pushes a new stack with the given symbol table.
-	void                push_stack(const function *, int, std::map<std::string, variable>&);
+	void                push_stack(const function *, int, ascript::symbol_table&);
 	//!Removes the topmost stack.
 	void                pop_stack(bool, int);
+	//!Removes all stacks, keeping their symbol tables for later use.
+	void                clear_stacks();
+	//!Points the current stack and the context symbol table to the topmost stack.
+	void                refresh_current_stack();
 
 	//!Functions that this script can use. Functions are implied to be owned by some other thing.
-	std::map<std::string, const function *> functions;
-	//!Current host pointer.
-	host *              current_host{nullptr};
-	//!Current output facility pointer.
-	out_interface *     out_facility{nullptr};
+	std::map<std::string, const function *, std::less<>> functions;
+	//!Functions shared with other interpreters, may be null.
+	std::shared_ptr<const function_table> shared_functions;
+	//!Context shared by all stacks, holds host, output and exchange values.
+	run_context         context{nullptr, nullptr};
 	//!Stacks. Read the stack description.
 	std::vector<stack>  stacks;
+	//!Symbol tables of popped stacks, ready to be used again.
+	std::vector<ascript::symbol_table> spare_tables;
 	//!Current stack (unsurprisingly, the topmost one).
 	stack *             current_stack{nullptr};
 	//!Signal reserved for breaking out of a loop.
@@ -135,10 +263,22 @@ class interpreter {
 	//!Signal reserved to indicate that the script yields.
 	                    yield_signal{false},
 	//!Signal reserved to indicate that execution failed, raised only when an exception is thrown.
-	                    failed_signal{false};
+	                    failed_signal{false},
+	//!Signal reserved to indicate that the yield was caused by preemption.
+	                    preempted_signal{false};
+	//!Instructions left before the execution is preempted.
+	std::size_t         instructions_left{0};
+	//!Point in time after which the execution is preempted, max if none.
+	std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+	//!Stats for executions with a deadline.
+	deadline_stats      stats;
+	//!Time source for timed yields.
+	const time_source * clock{&get_default_time_source()};
 	//!Point in time in which a timed yield will release.
-	std::chrono::time_point<std::chrono::system_clock> yield_release_time,
+	time_source::time_point yield_release_time,
 	                    yield_pause_time;
+	//!Event a "yield until" waits for, empty if none.
+	std::string         awaited_event;
 
 };
 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ascript/variable.h"
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace ascript {
+
+//!Interface for whatever delivers the messages that scripts send with the
+//!"post" procedure.
+/**
+* A message asks for a function to be run somewhere else, picked by a key
+* whose meaning is up to the implementation. Arguments can be arrays, 
+* structs, maps or builders, which the sender keeps a handle to, so 
+* implementations that run the function on another thread must send clones
+* of them (see variable::clone).
+*/
+struct mailbox {
+
+	//!Must deliver the message or throw if it cannot be delivered.
+	virtual void            post(std::size_t _key, const std::string& _function, const std::vector<variable>& _arguments)=0;
+};
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ascript/variable.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace ascript {
+
+//!Hash table from integer or string keys to values.
+/**
+* Open addressing with linear probing: keys and values live in a single
+* flat vector of slots, next to a vector with the hash of each slot, so a
+* lookup scans contiguous hashes and only compares the keys whose hash
+* matches. Removals shift the following entries back instead of leaving
+* tombstones. Nothing is allocated per entry, besides what the keys and
+* values themselves need.
+*
+* Integer and string keys can be mixed, 1 and "1" being different keys.
+* Values can be of any type but map, which rules out reference cycles.
+*
+* Scripts reach maps through variables, which share them by reference count
+* like arrays. Maps are not synchronized, so the same map must not be
+* modified from several threads at once.
+*
+* Methods throw std::runtime_error on invalid keys and values.
+*/
+class map {
+
+	public:
+
+	//!Returns the number of entries.
+	std::size_t             size() const {return count;}
+
+	//!Returns true if there are no entries.
+	bool                    empty() const {return 0==count;}
+
+	//!Returns the value for the key, nullptr if there is none.
+	const variable *        find(const variable&) const;
+
+	//!Returns true if there is a value for the key.
+	bool                    has(const variable& _key) const {return nullptr!=find(_key);}
+
+	//!Sets the value for the key, adding the key if needed.
+	void                    set(const variable&, const variable&);
+
+	//!Removes the key. Returns false if it was not there.
+	bool                    erase(const variable&);
+
+	//!Makes room for the given number of entries.
+	void                    reserve(std::size_t);
+
+	//!Calls the function with each key and value, in no particular order.
+	template<typename F>
+	void                    for_each(F _fn) const {
+
+		for(std::size_t i=0; i<hashes.size(); i++) {
+
+			if(hashes[i]) {
+
+				_fn(slots[i].key, slots[i].value);
+			}
+		}
+	}
+
+	private:
+
+	//!A key and its value.
+	struct slot {
+
+		variable            key{false},
+		                    value{false};
+	};
+
+	//!Returns the hash of a key, never 0. Throws if the key is invalid.
+	static std::uint32_t    hash(const variable&);
+
+	//!Returns the slot of the key, or the empty slot where it would go.
+	std::size_t             probe(const variable&, std::uint32_t) const;
+
+	//!Rehashes all entries into the given number of slots, a power of two.
+	void                    rehash(std::size_t);
+
+	std::vector<std::uint32_t> hashes; //!<Hash of each slot, 0 if empty.
+	std::vector<slot>       slots;
+	std::size_t             count{0};
+};
+
+}
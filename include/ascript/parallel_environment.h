@@ -0,0 +1,172 @@
+#pragma once
+
+#include "ascript/interpreter.h"
+#include "ascript/environment.h"
+#include "ascript/function_table.h"
+#include "ascript/host.h"
+#include "ascript/out_interface.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <map>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace ascript {
+
+//!An interpreter that failed during parallel_environment::run_all_ready.
+struct failed_interpreter {
+
+	std::size_t                 id; //!<Id of the interpreter.
+	std::string                 error; //!<What the exception said.
+};
+
+//!Outcome of a call to parallel_environment::run_all_ready.
+struct parallel_tick {
+
+	std::size_t                 runs{0}; //!<Interpreters that were run or resumed.
+	std::vector<resumed_interpreter> finished; //!<Interpreters that returned, with their values.
+	std::vector<failed_interpreter> failed; //!<Interpreters that threw.
+};
+
+//!Environment that runs its interpreters on a pool of threads.
+/**
+* Scripts are spawned from the owning thread and run in ticks: each call to
+* run_all_ready runs every new interpreter and resumes every yielding one
+* until they yield again or finish, spreading them across the workers. Each
+* worker takes interpreters from its own queue and steals from the others
+* when it runs out, so uneven scripts still keep all of them busy. An
+* interpreter runs on a single worker at a time, but can move to another one
+* on later ticks. Finished and failed interpreters are removed at the end of
+* the tick.
+*
+* All methods must be called from the same thread, the one that owns the
+* environment.
+*
+* The host is shared by all workers, so its methods will be called
+* concurrently and it must be thread-safe: either it synchronizes itself or
+* it only hands out data that no one writes to during the tick. The output
+* facility needs no such care: each interpreter buffers what it outputs and
+* hands it over, under a lock, when the script flushes, so the lines of
+* different scripts do not get mixed.
+*/
+class parallel_environment {
+
+	public:
+
+	//!Class constructor, zero workers means one per hardware thread.
+	                            parallel_environment(host&, out_interface&, std::size_t=0);
+
+	                            ~parallel_environment();
+
+	                            parallel_environment(const parallel_environment&)=delete;
+	parallel_environment&       operator=(const parallel_environment&)=delete;
+
+	//!Returns the number of worker threads.
+	std::size_t                 get_worker_count() const {return workers.size();}
+
+	//!Returns the number of current interpreters, either new or yielding.
+	std::size_t                 size() const {return entries.size();}
+
+	//!returns true if a function with that name is loaded.
+	bool                        has_function(const std::string& _funcname) const {return functions.count(_funcname);}
+
+	//!Loads functions from a file.
+	void                        load(const std::string&);
+
+	//!Loads a function, moves it so the parameter becomes useless.
+	void                        load(function&);
+
+	//!Creates an interpreter for the given function, which will start on the
+	//!next call to run_all_ready. Returns its id. The arguments are cloned 
+	//!(see variable::clone), so interpreters running on different workers 
+	//!never share an array, struct, map or builder.
+	std::size_t                 spawn(const std::string&, const std::vector<variable>&);
+
+	//!Runs or resumes all interpreters on the workers and blocks until all
+	//!of them have yielded, finished or failed.
+	/**
+	* Timed yields that are not over are checked and left alone. The ids in
+	* the result are those returned by spawn.
+	*/
+	parallel_tick               run_all_ready();
+
+	//!Removes all interpreters. Does not remove functions.
+	void                        clear() {entries.clear();}
+
+	private:
+
+	//!Output facility of a single interpreter, forwards whole flushes.
+	class buffered_out:public out_interface {
+
+		public:
+
+		                        buffered_out(out_interface& _target, std::mutex& _mutex):target{_target}, mutex{_mutex} {}
+		void                    out(const variable& _var) {buffer.push_back(_var);}
+		void                    flush();
+
+		private:
+
+		out_interface&          target;
+		std::mutex&             mutex;
+		std::vector<variable>   buffer;
+	};
+
+	//!An interpreter and everything needed to run it.
+	struct entry {
+
+		                        entry(std::size_t _id, const function& _fn, std::vector<variable>&& _arguments, out_interface& _target, std::mutex& _mutex)
+			:id{_id}, fn{&_fn}, arguments{std::move(_arguments)}, out{_target, _mutex} {}
+
+		std::size_t             id;
+		const function *        fn; //!<Function to start with, nullptr once started.
+		std::vector<variable>   arguments; //!<Arguments to start with.
+		buffered_out            out;
+		ascript::interpreter    interpreter;
+		std::optional<return_value> result; //!<Result of the last run.
+		std::string             error; //!<Set if the last run threw.
+	};
+
+	//!Jobs (indexes into entries) assigned to a worker.
+	struct worker_queue {
+
+		std::mutex              mutex;
+		std::deque<std::size_t> jobs;
+	};
+
+	//!Body of each worker thread.
+	void                        work(std::size_t);
+
+	//!Takes a job from the worker's own queue or steals one from another.
+	bool                        take_job(std::size_t, std::size_t&);
+
+	//!Runs or resumes an interpreter, catching whatever it throws.
+	void                        run_job(std::size_t);
+
+	using function_map=std::map<std::string, ascript::function>;
+
+	host&                       host_instance;
+	out_interface&              outfacility;
+	std::mutex                  out_mutex; //!<Held while forwarding a flush.
+
+	function_map                functions;
+	std::shared_ptr<const ascript::function_table> shared_functions;
+	std::vector<std::unique_ptr<entry>> entries;
+	std::size_t                 counter{0};
+
+	std::vector<std::thread>    workers;
+	std::vector<std::unique_ptr<worker_queue>> queues;
+	std::mutex                  tick_mutex; //!<Guards tick and stopping.
+	std::condition_variable     tick_start, //!<Wakes workers when a tick starts.
+	                            tick_end; //!<Wakes the owner when all jobs are done.
+	std::size_t                 tick{0}; //!<Number of the current tick.
+	bool                        stopping{false};
+	std::atomic<std::size_t>    pending{0}; //!<Jobs of the current tick not yet done.
+};
+
+}
@@ -7,6 +7,9 @@
 #include <vector>
 #include <map>
 #include <functional>
+#include <memory>
+#include <string>
+#include <utility>
 
 namespace ascript {
 
@@ -14,13 +17,21 @@ class parser {
 
 	public:
 
+	//!Parses the tokens into functions. Struct types declared here stay 
+	//!known to later calls on the same parser.
 	std::vector<function>     parse(const std::vector<token>&);
 
+	//!Returns the struct type with the given name, nullptr if none.
+	std::shared_ptr<const struct_type> get_struct_type(const std::string&) const;
+
 	private:
 
 	//!Root mode, little more than declaring functions
 	void                    root_mode();
 
+	//!Reads a struct type declaration.
+	void                    struct_mode(const token&);
+
 	//!Starts a function.
 	void                    function_mode(const token&, const std::vector<parameter>&, int);
 
@@ -41,6 +52,17 @@ class parser {
 	//!Builds a function instruction.
 	std::unique_ptr<instruction_function> build_function(const token&);
 
+	//!Builds a built-in function instruction, reading its arguments.
+	std::unique_ptr<instruction_function> built_in_function_mode(const token&);
+
+	//!Replaces a function whose arguments are all literals by the value it
+	//!evaluates to. Returns the function untouched if it cannot be folded.
+	std::unique_ptr<instruction_function> fold(std::unique_ptr<instruction_function>) const;
+
+	//!Resolves an argument in the form type.field to the struct type and 
+	//!the index of the field.
+	std::pair<std::shared_ptr<const struct_type>, std::size_t> resolve_field(const variable&, const token&) const;
+
 	//!Reading if branches...
 	void                    conditional_branch_mode(int, int);
 
@@ -83,12 +105,17 @@ class parser {
 	//!Returns true if the token is a built-in function.
 	bool                    is_built_in_function(const token&) const;
 
+	//!Returns true if the token is a built-in function without side effects
+	//!that can be evaluated when parsing, if its arguments are literals.
+	bool                    is_foldable(const token&) const;
+
 	//!Returns true if the token is a built-in procedure.
 	bool                    is_built_in_procedure(const token&) const;
 
 	std::vector<token>      tokens;
 	std::vector<function>   functions;
 	function                current_function;
+	std::map<std::string, std::shared_ptr<const struct_type>> struct_types;
 };
 
 }
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ascript/variable.h"
+
+#include <string>
+#include <mutex>
+#include <functional>
+
+namespace ascript {
+
+//!Handle to a host query that completes at some later point.
+/**
+* Returned by host::host_query_async. The host keeps a copy of the handle and
+* completes it, from any thread, once the answer is ready. Meanwhile, the 
+* script that asked is suspended as if it had yielded.
+*/
+class pending_query {
+
+	public:
+
+	//!Completes the query with a value. Can be called from any thread. Will
+	//!throw if the query was already completed. The value is cloned (see
+	//!variable::clone), so the caller can keep using it.
+	void                    complete(const variable&);
+
+	//!Completes the query with an error, which makes the script fail. Can be
+	//!called from any thread. Will throw if the query was already completed.
+	void                    fail(const std::string&);
+
+	//!Returns true once the query has been completed or failed.
+	bool                    is_done() const;
+
+	//!Returns true if the query failed. Only meaningful once done.
+	bool                    is_failed() const;
+
+	//!Returns the value of a completed query.
+	const variable&         get_value() const {return value;}
+
+	//!Returns the error of a failed query.
+	const std::string&      get_error() const {return error;}
+
+	//!Sets a function to be called once the query is done, from whatever 
+	//!thread completes it. If it is already done, it is called right away.
+	void                    set_callback(std::function<void()>);
+
+	private:
+
+	//!Marks the query as done and calls the callback, if any.
+	void                    finish(std::unique_lock<std::mutex>&);
+
+	mutable std::mutex      mutex; //!<Guards everything below.
+	bool                    done{false},
+	                        failed{false};
+	variable                value{false};
+	std::string             error;
+	std::function<void()>   callback;
+};
+
+}
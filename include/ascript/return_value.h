@@ -20,12 +20,21 @@ class return_value {
 	//!Indicates the type of returned value.
 	enum class types{value, nothing, yield};
 
+	//!Indicates what caused a yield.
+	enum class yields{
+		statement, //!<The script executed a yield statement.
+		preemption //!<The interpreter stopped the script on its own.
+	};
+
 	//!class constructor
 	                return_value(const variable&);
 
 	//!class constructor
 	                return_value(types);
 
+	//!class constructor for yield values.
+	                return_value(yields);
+
 	//!returns true if there's a value to collect (not yielding, nor nothing).
 	                operator bool() const;
 
@@ -35,15 +44,21 @@ class return_value {
 	//!returns true if no return value was specified but the function returned.
 	bool            is_nothing() const;
 
-	//!returns true if there's no return value because of a yield statement.
+	//!returns true if there's no return value because of a yield statement
+	//!or because the interpreter was preempted.
 	bool            is_yield() const;
 
+	//!returns true if there's no return value because the interpreter was 
+	//!preempted (for example, because it ran out of instructions).
+	bool            is_preempted() const;
+
 	//!returns the value (if any, throws if not).
 	const variable& get() const;
 
 	private:
 
 	types           type; //!<Holds the type of return value.
+	bool            preempted{false}; //!<True if a yield came from preemption.
 	std::optional<variable> value; //<!Holds the value.
 };
 
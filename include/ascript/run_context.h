@@ -3,9 +3,13 @@
 #include "ascript/host.h"
 #include "ascript/variable.h"
 #include "ascript/out_interface.h"
+#include "ascript/symbol_table.h"
+#include "ascript/mailbox.h"
+#include "ascript/pending_query.h"
 
-#include <map>
 #include <optional>
+#include <vector>
+#include <memory>
 
 namespace ascript {
 
@@ -14,6 +18,11 @@ namespace ascript {
 //!interpreter and the interpreter itself does not try to typecast them at all:
 //!all instructions are supposed to be able to perform whatever action through
 //!these run_context structures.
+/**
+* There is a single run_context per interpreter, shared by all its stacks. The
+* interpreter points the symbol table to the topmost stack whenever stacks are
+* pushed or popped, everything else is interpreter-wide scratch space.
+*/
 struct run_context {
 
 	//!Different signals that can be read by an interpreter.
@@ -22,16 +31,20 @@ struct run_context {
 	//!Class construction.
 	                                run_context(host*, out_interface*);
 
-	//Clears signals and values for each new instruction.
-	void                            reset();
+	//Clears the signal for each new instruction. Values are not cleared: 
+	//any instruction raising a signal writes the values that go with it.
+	void                            reset() {signal=signals::none;}
 
-	std::map<std::string, variable> symbol_table; //!< Current symbol table.
+	ascript::symbol_table *         symbol_table{nullptr}; //!< Symbol table of the current stack.
 	host *                          host_ptr{nullptr}; //!< Pointer to the host object.
 	out_interface *                 out_facility{nullptr}; //!< Pointer to the output facility.
+	mailbox *                       mailbox_ptr{nullptr}; //!< Where posted messages go, may be null.
 	signals                         signal{signals::none}; //!< Currently signaled signal.
+	overflow_policy                 overflow{overflow_policy::wrap}; //!< What integer arithmetic does on overflow.
 	variable                        value{false}; //!<A value produced by some function or the index of a block.
 	std::optional<variable>         return_register; //!<The register where returned values are stored.
-	std::vector<variable>           arguments; //!<Vector of arguments to be passed to a call from sigcall: the instruction will write them here, the interpreter will read them.
+	std::shared_ptr<ascript::pending_query> pending_query; //!<Host query the script waits for, if any.
+	std::vector<variable>           arguments; //!<Vector of arguments to be passed to a call from sigcall: the instruction will write them here, the interpreter will read them. Also used to pass arguments to the host.
 
 };
 
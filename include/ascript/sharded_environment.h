@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ascript/environment.h"
+#include "ascript/mailbox.h"
+#include "ascript/host.h"
+#include "ascript/out_interface.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace ascript {
+
+//!Host and output facility of a single shard.
+struct shard_view {
+
+	host&                       host_view;
+	out_interface&              out;
+};
+
+//!What a shard did in a tick.
+struct shard_tick {
+
+	std::size_t                 drained{0}; //!<Run requests and messages run.
+	std::vector<resumed_interpreter> resumed; //!<Interpreters resumed by timed yields, events and completed host queries, including those that failed.
+	std::vector<std::string>    errors; //!<Errors of messages that failed.
+};
+
+//!A set of independent environments, each one running on its own thread.
+/**
+* Each shard is a plain environment with its own host view, output facility
+* and thread, which is pinned to a core when the platform allows it. Work is
+* placed on a shard by a key chosen by the caller (a region of the map, for
+* example): key modulo shard count. Scripts reach other shards only through
+* the "post" procedure:
+*
+*	post [key, "function", arguments...];
+*
+* which queues a run request on the shard for that key, to be run on its 
+* next tick. Posting to a shard whose queue is full makes the script fail.
+* Arguments are cloned when posted, like those of any submitted request, so
+* arrays, structs, maps and builders never cross shards.
+*
+* A tick runs the requests and messages queued when it starts (messages 
+* posted during the tick wait for the next one, so shards posting to each 
+* other cannot keep a tick going forever), then signals the events queued 
+* with signal, then resumes expired timed yields and interpreters whose 
+* host queries have completed.
+*
+* Shards only run during run_all_ready. In between, the owning thread can 
+* touch any shard through get_shard.
+*/
+class sharded_environment {
+
+	public:
+
+	//!Class constructor, one shard per view. The last parameter is the 
+	//!capacity of the queue of requests and messages of each shard.
+	                            sharded_environment(const std::vector<shard_view>&, std::size_t=1024);
+
+	                            ~sharded_environment();
+
+	                            sharded_environment(const sharded_environment&)=delete;
+	sharded_environment&        operator=(const sharded_environment&)=delete;
+
+	//!Returns the number of shards.
+	std::size_t                 get_shard_count() const {return shards.size();}
+
+	//!Returns the shard in which the key is placed.
+	std::size_t                 get_shard_index(std::size_t _key) const {return _key % shards.size();}
+
+	//!Returns the environment of a shard. Must not be used while 
+	//!run_all_ready is running.
+	environment&                get_shard(std::size_t _index) {return shards[_index]->env;}
+
+	//!Loads functions from a file in all shards.
+	void                        load(const std::string&);
+
+	//!Queues a run request on the shard for the key. Can be called from any
+	//!thread. Returns false if that shard's queue is full. The completion
+	//!callback is called from the shard thread.
+	bool                        submit(std::size_t, run_request&);
+
+	//!Queues an event to be signalled in all shards on the next tick, which
+	//!resumes their interpreters waiting for it with "yield until". Must not
+	//!be used while run_all_ready is running.
+	void                        signal(const std::string& _event) {events.push_back(_event);}
+
+	//!Runs a tick in all shards, in parallel. Blocks until all are done.
+	std::vector<shard_tick>     run_all_ready();
+
+	private:
+
+	//!Delivers messages posted by scripts of a shard.
+	class shard_mailbox:public mailbox {
+
+		public:
+
+		                        shard_mailbox(sharded_environment& _owner):owner{_owner} {}
+		void                    post(std::size_t, const std::string&, const std::vector<variable>&);
+
+		private:
+
+		sharded_environment&    owner;
+	};
+
+	struct shard {
+
+		                        shard(const shard_view&, std::size_t, sharded_environment&);
+
+		environment             env;
+		shard_mailbox           box;
+		shard_tick              last_tick;
+		std::thread             thread;
+	};
+
+	//!Body of each shard thread.
+	void                        work(std::size_t);
+
+	//!Runs a tick on a shard.
+	void                        run_tick(shard&);
+
+	std::vector<std::unique_ptr<shard>> shards;
+	std::vector<std::string>    events; //!<Events to signal on the next tick.
+	std::mutex                  tick_mutex; //!<Guards tick and stopping.
+	std::condition_variable     tick_start, //!<Wakes shards when a tick starts.
+	                            tick_end; //!<Wakes the owner when all shards are done.
+	std::size_t                 tick{0}; //!<Number of the current tick.
+	bool                        stopping{false};
+	std::atomic<std::size_t>    pending{0}; //!<Shards still running the current tick.
+};
+
+}
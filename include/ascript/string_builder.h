@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ascript/variable.h"
+
+#include <string>
+#include <string_view>
+
+namespace ascript {
+
+//!Mutable string that grows at the end, for building long strings piece by
+//!piece.
+/**
+* Appending takes amortized constant time, as the storage grows
+* geometrically, instead of copying the whole string each time like
+* repeated concatenations do. Once built, the string is frozen into a
+* regular string variable with a single allocation (none if it is short
+* enough to be stored inline).
+*
+* Scripts reach builders through variables, which share them by reference
+* count like arrays. Builders are not synchronized, so the same builder must
+* not be modified from several threads at once.
+*
+* Methods throw std::runtime_error on values that cannot be written as text.
+*/
+class string_builder {
+
+	public:
+
+	//!Room a buffer needs to hold any number written by write.
+	static constexpr std::size_t number_capacity=32;
+
+	//!Returns the text of a boolean, integer, double, string or builder: 
+	//!booleans are "true" or "false", doubles are written in their shortest
+	//!form with a dot, so they read back as the same value, and builders
+	//!give their contents. Numbers are written to the buffer, which must 
+	//!hold number_capacity characters. Throws for any other type.
+	static std::string_view write(const variable&, char *);
+
+	//!Returns the length of the string built so far.
+	std::size_t             size() const {return text.size();}
+
+	//!Returns the string built so far. Valid until the builder is modified.
+	std::string_view        view() const {return text;}
+
+	//!Appends characters.
+	void                    append(std::string_view _str) {text.append(_str);}
+
+	//!Appends characters.
+	void                    append(const char * _str) {append(std::string_view{_str});}
+
+	//!Appends the text of a value, as write returns it.
+	void                    append(const variable&);
+
+	//!Makes room for the given number of characters.
+	void                    reserve(std::size_t _size) {text.reserve(_size);}
+
+	//!Returns the string built so far and empties the builder, which keeps
+	//!its memory for the next string.
+	variable                freeze();
+
+	private:
+
+	std::string             text;
+};
+
+}
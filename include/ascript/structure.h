@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ascript/variable.h"
+#include "ascript/instructions.h"
+
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <cstdint>
+
+namespace ascript {
+
+//!Value of a struct type, with its fields in declaration order.
+/**
+* The header and the fields share a single allocation and fields are reached
+* by index: scripts resolve field names to indexes when they are parsed, so
+* reading or writing a field never looks up a name. The lookups by name are
+* meant for the host.
+*
+* Like arrays, structs are shared by reference count between variables, so
+* a struct goes to and comes from the host as a single value. Fields cannot
+* hold structs or maps, which rules out reference cycles.
+*
+* Setters throw std::runtime_error when the value does not match the type of
+* the field.
+*/
+class structure {
+
+	public:
+
+	                        structure(const structure&)=delete;
+	structure&              operator=(const structure&)=delete;
+
+	//!Returns the type of the struct.
+	const struct_type&      get_type() const {return *type;}
+
+	//!Returns the number of fields.
+	std::size_t             size() const {return type->fields.size();}
+
+	//!Returns the field at the given index, unchecked.
+	const variable&         get(std::size_t _index) const {return fields()[_index];}
+
+	//!Returns the field with the given name, throws if there is none.
+	const variable&         get(std::string_view) const;
+
+	//!Sets the field at the given index, unchecked.
+	void                    set(std::size_t, const variable&);
+
+	//!Sets the field with the given name, throws if there is none.
+	void                    set(std::string_view, const variable&);
+
+	private:
+
+	friend struct variable;
+
+	                        structure(std::shared_ptr<const struct_type>);
+	                        ~structure();
+
+	//!Returns a new struct with one reference and its fields set to the
+	//!default value of their type.
+	static structure *      create(std::shared_ptr<const struct_type>);
+	//!Destroys a struct made by create.
+	static void             destroy(structure *);
+
+	//!Returns the index of the named field, throws if there is none.
+	std::size_t             index_of(std::string_view) const;
+
+	variable *              fields() {return reinterpret_cast<variable *>(this+1);}
+	const variable *        fields() const {return reinterpret_cast<const variable *>(this+1);}
+
+	std::atomic<std::uint32_t> references{1};
+	std::shared_ptr<const struct_type> type;
+};
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ascript/variable.h"
+
+#include <vector>
+#include <string>
+#include <string_view>
+
+namespace ascript {
+
+//!Symbols available to a stack, by name.
+/**
+* Scripts rarely have more than a handful of symbols in scope, so they are 
+* kept in a flat vector and looked up linearly, which beats a tree for these
+* sizes. Clearing or copying over a table keeps its memory, so tables that
+* are recycled stop allocating once they have grown enough.
+*/
+class symbol_table {
+
+	public:
+
+	//!A named value.
+	struct symbol {
+
+		std::string             name;
+		variable                value;
+	};
+
+	using const_iterator=std::vector<symbol>::const_iterator;
+
+	//!Returns the value of the symbol with the given name, nullptr if none.
+	const variable *            find(std::string_view) const;
+
+	//!Returns the value of the symbol with the given name, nullptr if none.
+	variable *                  find(std::string_view);
+
+	//!Returns true if there's a symbol with the given name.
+	bool                        has(std::string_view _name) const {return nullptr!=find(_name);}
+
+	//!Adds a symbol. Does not check if a symbol by that name exists.
+	void                        insert(const std::string&, variable);
+
+	//!Overwrites the values of all symbols that also exist in the given 
+	//!table, moving them out of it. The given table keeps its symbols, but 
+	//!their values are left unspecified.
+	void                        update_from(symbol_table&);
+
+	//!Removes all symbols, keeping the memory.
+	void                        clear() {symbols.clear();}
+
+	//!Returns the number of symbols.
+	std::size_t                 size() const {return symbols.size();}
+
+	const_iterator              begin() const {return std::begin(symbols);}
+	const_iterator              end() const {return std::end(symbols);}
+
+	private:
+
+	std::vector<symbol>         symbols;
+};
+
+}
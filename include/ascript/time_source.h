@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+
+namespace ascript {
+
+//!Interface for the clocks that measure timed yields.
+/**
+* Interpreters ask their time source for the current time whenever they need
+* to know if a timed yield has expired. The default one is steady_clock, but
+* the host can provide its own, for example to advance time once per tick or
+* to run simulations faster than real time.
+*/
+class time_source {
+
+	public:
+
+	//!All time sources, even virtual ones, express time as steady_clock points.
+	using time_point=std::chrono::steady_clock::time_point;
+
+	virtual                     ~time_source() {}
+
+	//!Must return the current time.
+	virtual time_point          now() const=0;
+};
+
+//!Time source backed by std::chrono::steady_clock, used by default.
+class steady_time_source:public time_source {
+
+	public:
+
+	//!Returns steady_clock::now().
+	time_point                  now() const {return std::chrono::steady_clock::now();}
+};
+
+//!Time source that only moves when told so.
+/**
+* Meant to be driven by the host: advance it once per tick and resume as many
+* interpreters as needed against the same value. It is not synchronized, so
+* it must not be advanced while interpreters using it are running.
+*/
+class manual_time_source:public time_source {
+
+	public:
+
+	//!Returns the current time.
+	time_point                  now() const {return current;}
+
+	//!Moves the current time forward.
+	void                        advance(std::chrono::milliseconds _ms) {current+=_ms;}
+
+	//!Sets the current time.
+	void                        set(time_point _time) {current=_time;}
+
+	private:
+
+	time_point                  current{}; //!<Current time, starts at the epoch.
+};
+
+//!Time source that follows another one but can be frozen.
+/**
+* While paused, now() stays at the point in which pause was called. Once
+* unpaused, time continues from that point on, so all the time spent paused
+* is skipped at once, regardless of how many timers depend on this source.
+*/
+class pausable_time_source:public time_source {
+
+	public:
+
+	//!Class constructor. The source must outlive this object.
+	                            pausable_time_source(const time_source&);
+
+	//!Returns the current time, minus all the time spent paused.
+	time_point                  now() const;
+
+	//!Freezes the time. Does nothing if already paused.
+	void                        pause();
+
+	//!Lets the time run again. Does nothing if not paused.
+	void                        unpause();
+
+	//!Returns true if paused.
+	bool                        is_paused() const {return paused;}
+
+	//!Changes the underlying source. Time will jump to whatever the new 
+	//!source says (minus the time spent paused so far).
+	void                        set_source(const time_source&);
+
+	private:
+
+	const time_source *         source; //!<Underlying source.
+	time_point                  pause_time{}; //!<Underlying time at which pause was called.
+	std::chrono::steady_clock::duration offset{0}; //!<Total time spent paused.
+	bool                        paused{false}; //!<True if paused.
+};
+
+//!Returns the time source used by interpreters unless told otherwise.
+const time_source&          get_default_time_source();
+
+}
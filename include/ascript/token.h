@@ -2,6 +2,7 @@
 
 #include <string>
 #include <ostream>
+#include <cstdint>
 
 namespace ascript {
 
@@ -28,17 +29,55 @@ struct token {
 		fn_add,
 		fn_substract,
 		fn_concatenate,
+		fn_multiply,
+		fn_divide,
+		fn_modulo,
+		fn_min,
+		fn_max,
+		fn_abs,
+		fn_clamp,
+		fn_string_length,
+		fn_substring,
+		fn_string_find,
+		fn_starts_with,
+		fn_string_compare,
+		fn_to_int,
+		fn_to_double,
+		fn_to_string,
+		fn_format,
+		fn_builder,
+		fn_builder_freeze,
 		fn_is_int,
 		fn_is_bool,//done
 		fn_is_double,
 		fn_is_string,
+		fn_is_array,
+		fn_array,
+		fn_array_size,
+		fn_array_get,
+		fn_array_pop,
+		fn_array_slice,
+		fn_struct_get,
+		fn_is_map,
+		fn_map,
+		fn_map_size,
+		fn_map_get,
+		fn_map_has,
 		fn_host_has,
 		fn_host_get,
 		fn_host_query,
+		fn_host_query_async,
 		pr_host_delete,
 		pr_host_set,
 		pr_host_add,
 		pr_host_do,
+		pr_post,
+		pr_array_set,
+		pr_array_push,
+		pr_struct_set,
+		pr_map_set,
+		pr_map_erase,
+		pr_builder_append,
 		pr_out,
 		pr_fail,
 		kw_not,
@@ -51,6 +90,7 @@ struct token {
 		kw_endloop,
 		kw_yield,
 		kw_for,
+		kw_until,
 		kw_return,
 		kw_exit,
 		kw_let,
@@ -63,6 +103,8 @@ struct token {
 		kw_double,
 		kw_anytype,
 		kw_as,
+		kw_struct,
+		kw_new,
 		kw_beginfunction,
 		kw_endfunction,
 		semicolon,
@@ -73,7 +115,7 @@ struct token {
 
 	types       type; //!< Current token type.
 	std::string str_val; //!< String value, if any.
-	int         int_val{0}; //!< Integer value, if any.
+	std::int64_t int_val{0}; //!< Integer value, if any.
 	double      double_val{0.}; //!< Double value, if any.
 	bool        bool_val{false}; //!< Boolean value, if any.
 	int         line_number{0}; //!< Stores the line where the word originating the token was.
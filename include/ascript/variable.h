@@ -1,60 +1,321 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <ostream>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 
 namespace ascript {
 
+class array;
+class map;
+class structure;
+class string_builder;
+struct struct_type;
+
+//!What integer arithmetic does when the result does not fit in 64 bits.
+enum class overflow_policy:std::uint8_t {
+	wrap, //!<The result wraps around, as in two's complement.
+	check //!<Throws std::runtime_error.
+};
+
 //!More like a "value". Represents variables, parameters, return values...
 /**
-* The implementation is easy (a member for each type) though likely very 
-* ineficcient.
+* A tagged union packed in 16 bytes: booleans, 64 bit integers and doubles are
+* stored inline, and so are strings (and symbols) of up to small_capacity
+* characters. Longer strings live in a reference counted heap buffer that
+* is never modified once built, so copies share it instead of copying the
+* characters. Reference counts are atomic, so copies can be made from
+* several threads at once.
+*
+* Arrays, maps, structs and string builders live on the heap too, with the
+* same atomic reference count, but they are shared handles: copies refer to
+* the same elements, so changes made through one are seen through all of
+* them.
+*
+* Copying a variable that does not hold a long string or one of those is a
+* plain copy of its 16 bytes. Arithmetic and comparisons between two integers
+* are inlined and never throw, unless overflow is checked; anything else
+* goes through the general, out of line, path.
 */
 struct variable {
 
 	//!Each variable can be of a given type.
-	enum class              types{
-		boolean, 
-		integer, 
-		string, 
-		decimal, 
-		symbol
-	} type{types::integer}; //!< Current type.
+	enum class              types:std::uint8_t {
+		boolean,
+		integer,
+		string,
+		decimal,
+		symbol,
+		array,
+		structure,
+		map,
+		builder
+	};
+
+	//!Longest string that is stored inline.
+	static constexpr std::size_t small_capacity=14;
 
 	//!Class constructor for booleans.
 	                        variable(bool);
 	//!Class constructor for integers.
-	                        variable(int);
+	                        variable(int _val):variable{(long long)_val} {}
+	//!Class constructor for integers.
+	                        variable(long _val):variable{(long long)_val} {}
+	//!Class constructor for integers, all of them are stored in 64 bits.
+	                        variable(long long);
 	//!Class constructor for doubles.
 	                        variable(double);
 	//!Class constructor for strings.
 	                        variable(const std::string&);
+	//!Class constructor for strings.
+	                        variable(std::string_view);
 	//!Class constructor for strings.
 	                        variable(const char);
 	//!Class constructor for strings.
 	                        variable(const char *);
 	//!Hacky class constructor for a symbol, it does not really matter what the types parameter express.
-	                        variable(const std::string&, types);
+	                        variable(std::string_view, types);
+	//!Class constructor for arrays, moves the array to shared storage.
+	                        variable(ascript::array&&);
+	//!Class constructor for maps, moves the map to shared storage.
+	                        variable(ascript::map&&);
+	//!Class constructor for string builders, moves the builder to shared 
+	//!storage.
+	                        variable(ascript::string_builder&&);
+	//!Class constructor for structs, the fields start at the default value
+	//!of their type (0, 0., false, an empty string, array or builder).
+	                        variable(std::shared_ptr<const struct_type>);
+
+	                        variable(const variable&);
+	                        variable(variable&&) noexcept;
+	variable&               operator=(const variable&);
+	variable&               operator=(variable&&) noexcept;
+	                        ~variable() {release();}
+
+	//!Boolean value, false if not a boolean.
+	bool                    get_bool() const {return types::boolean==type && load<bool>();}
+	//!Integer value, 0 if not an integer.
+	std::int64_t            get_int() const {return types::integer==type ? load<std::int64_t>() : 0;}
+	//!Double value, 0 if not a double.
+	double                  get_double() const {return types::decimal==type ? load<double>() : 0.;}
+	//!String value (or symbol name), empty if neither. Valid for as long as
+	//!the variable is not modified or destroyed.
+	std::string_view        get_string() const;
+	//!Array, nullptr if not an array. Shared with every copy of the variable.
+	ascript::array *        get_array() const;
+	//!Struct, nullptr if not a struct. Shared with every copy of the variable.
+	ascript::structure *    get_struct() const;
+	//!Map, nullptr if not a map. Shared with every copy of the variable.
+	ascript::map *          get_map() const;
+	//!String builder, nullptr if not a builder. Shared with every copy of
+	//!the variable.
+	ascript::string_builder * get_builder() const;
+
 	//!Comparison operator. These are quite stringent and will want the types to match.
-	bool                    operator==(const variable&) const;
+	bool                    operator==(const variable& _other) const {
+
+		if(types::integer==type && types::integer==_other.type) {
+
+			return load<std::int64_t>()==_other.load<std::int64_t>();
+		}
+
+		return equals(_other);
+	}
 	//!Unequality operator.
 	bool                    operator!=(const variable& _other) const {return !(*this==_other);}
 	//!Aritmetic operator which only works on numeric types.
-	bool                    operator<(const variable&) const;
+	bool                    operator<(const variable& _other) const {
+
+		if(types::integer==type && types::integer==_other.type) {
+
+			return load<std::int64_t>() < _other.load<std::int64_t>();
+		}
+
+		return lesser_than(_other);
+	}
 	//!Aritmetic operator which only works on numeric types.
-	bool                    operator>(const variable&) const;
+	bool                    operator>(const variable& _other) const {
+
+		if(types::integer==type && types::integer==_other.type) {
+
+			return load<std::int64_t>() > _other.load<std::int64_t>();
+		}
+
+		return greater_than(_other);
+	}
 	//!Aritmetic operator which only works on numeric types.
-	variable                operator+(const variable&) const;
+	variable                operator+(const variable&) const&;
+	//!Same as above, reusing the temporary.
+	variable                operator+(const variable&) &&;
 	//!Aritmetic operator which only works on numeric types.
-	variable                operator-(const variable&) const;
+	variable                operator-(const variable&) const&;
+	//!Same as above, reusing the temporary.
+	variable                operator-(const variable&) &&;
+	//!Adds in place, only works on numeric types. Integers wrap around.
+	variable&               operator+=(const variable& _other) {return add(_other, overflow_policy::wrap);}
+	//!Substracts in place, only works on numeric types. Integers wrap around.
+	variable&               operator-=(const variable& _other) {return substract(_other, overflow_policy::wrap);}
+	//!Adds in place, only works on numeric types. The policy tells what to
+	//!do when integers overflow.
+	variable&               add(const variable& _other, overflow_policy _policy) {
+
+		std::int64_t result;
+		if(types::integer==type && types::integer==_other.type
+			&& (!__builtin_add_overflow(load<std::int64_t>(), _other.load<std::int64_t>(), &result) || overflow_policy::wrap==_policy)
+		) {
+
+			store(result);
+			return *this;
+		}
+
+		return add_slow(_other);
+	}
+	//!Substracts in place, only works on numeric types. The policy tells what
+	//!to do when integers overflow.
+	variable&               substract(const variable& _other, overflow_policy _policy) {
+
+		std::int64_t result;
+		if(types::integer==type && types::integer==_other.type
+			&& (!__builtin_sub_overflow(load<std::int64_t>(), _other.load<std::int64_t>(), &result) || overflow_policy::wrap==_policy)
+		) {
+
+			store(result);
+			return *this;
+		}
+
+		return substract_slow(_other);
+	}
+	//!Multiplies in place, only works on numeric types. The policy tells 
+	//!what to do when integers overflow.
+	variable&               multiply(const variable& _other, overflow_policy _policy) {
+
+		std::int64_t result;
+		if(types::integer==type && types::integer==_other.type
+			&& (!__builtin_mul_overflow(load<std::int64_t>(), _other.load<std::int64_t>(), &result) || overflow_policy::wrap==_policy)
+		) {
+
+			store(result);
+			return *this;
+		}
+
+		return multiply_slow(_other);
+	}
+	//!Divides in place, only works on numeric types. Integer division 
+	//!truncates and throws when dividing by 0. The lowest integer divided by
+	//!-1 is the only integer overflow, handled as the policy says.
+	variable&               divide(const variable& _other, overflow_policy _policy) {
+
+		if(types::integer==type && types::integer==_other.type && _other.load<std::int64_t>() > 0) {
+
+			store(load<std::int64_t>() / _other.load<std::int64_t>());
+			return *this;
+		}
+
+		return divide_slow(_other, _policy);
+	}
+	//!Replaces the value by the remainder of dividing it, only works on 
+	//!numeric types. The remainder has the sign of the dividend. Integers
+	//!throw when dividing by 0.
+	variable&               modulo(const variable& _other) {
+
+		if(types::integer==type && types::integer==_other.type && _other.load<std::int64_t>() > 0) {
+
+			store(load<std::int64_t>() % _other.load<std::int64_t>());
+			return *this;
+		}
+
+		return modulo_slow(_other);
+	}
 	//!Concatenation operator.
 	variable                concatenate(const variable&) const;
-	bool                    bool_val{false}; //!<Boolean value
-	int                     int_val{0}; //!<Integer value
-	double                  double_val{0.}; //!<Double value
-	std::string             str_val; //!<String value
+	//!Returns a copy that shares nothing mutable with this one: arrays, 
+	//!structs, maps and builders are copied along with their contents, so 
+	//!it can be handed to another thread. Other values are copied as usual.
+	variable                clone() const;
+
+	//!Builds a string of the given length with a single allocation (none if
+	//!it fits inline). The function receives a pointer to the characters
+	//!and must write all of them.
+	template<typename F>
+	static variable         build_string(std::size_t _length, F _fill) {
+
+		variable result{std::string_view{}};
+		_fill(result.reserve_string(_length));
+		return result;
+	}
+
+	private:
+
+	//!Heap storage of long strings.
+	struct string_buffer;
+	//!Heap storage of arrays, maps and string builders.
+	template<typename T> struct shared_value;
+
+	//!Marks a string that lives in a string_buffer, an array, a map, a 
+	//!struct or a string builder.
+	static constexpr std::uint8_t heap_size=0xff;
+
+	//!Reads a value of the given type from the storage.
+	template<typename T> T  load() const;
+	//!Writes a value of the given type to the storage.
+	template<typename T> void store(T);
+
+	//!Stores a string, inline or in a new buffer.
+	void                    assign_string(std::string_view);
+	//!Makes room for a string of the given length in an empty string
+	//!variable and returns where its characters go.
+	char *                  reserve_string(std::size_t);
+	//!Returns the buffer of a long string, nullptr if there is none.
+	string_buffer *         get_buffer() const;
+	//!Adds a reference to the heap storage, if any.
+	void                    acquire() const;
+	//!Drops the reference to the heap storage, if any.
+	void                    release();
+
+	//!Equality for anything but two integers.
+	bool                    equals(const variable&) const;
+	//!Lesser than for anything but two integers.
+	bool                    lesser_than(const variable&) const;
+	//!Greater than for anything but two integers.
+	bool                    greater_than(const variable&) const;
+	//!Addition for anything but two integers that do not overflow.
+	variable&               add_slow(const variable&);
+	//!Substraction for anything but two integers that do not overflow.
+	variable&               substract_slow(const variable&);
+	//!Multiplication for anything but two integers that do not overflow.
+	variable&               multiply_slow(const variable&);
+	//!Division for anything but two integers with a positive divisor.
+	variable&               divide_slow(const variable&, overflow_policy);
+	//!Remainder for anything but two integers with a positive divisor.
+	variable&               modulo_slow(const variable&);
+
+	alignas(8) char         storage[small_capacity]; //!<Value, inline characters or heap pointer.
+	std::uint8_t            small_size{0}; //!<Length of an inline string, heap_size for heap storage.
+
+	public:
+
+	//!Current type, read only.
+	types                   type{types::integer};
 };
 
+static_assert(sizeof(variable)==16, "variables must take 16 bytes");
+
+template<typename T> T variable::load() const {
+
+	T result;
+	std::memcpy(&result, storage, sizeof(T));
+	return result;
+}
+
+template<typename T> void variable::store(T _value) {
+
+	static_assert(sizeof(T) <= small_capacity, "value does not fit the storage");
+	std::memcpy(storage, &_value, sizeof(T));
+}
+
 std::ostream& operator<<(std::ostream&, const variable&);
 
 }
@@ -0,0 +1,190 @@
+#include "ascript/array.h"
+
+#include <stdexcept>
+#include <string>
+#include <iterator>
+#include <type_traits>
+
+using namespace ascript;
+
+std::size_t array::size() const {
+
+	return std::visit(
+		[](const auto& _elements) -> std::size_t {
+
+			if constexpr(std::is_same_v<const std::monostate&, decltype(_elements)>) {
+
+				return 0;
+			}
+			else {
+
+				return _elements.size();
+			}
+		},
+		storage
+	);
+}
+
+variable::types array::get_type() const {
+
+	switch(storage.index()) {
+
+		case 1: return variable::types::boolean;
+		case 2: return variable::types::integer;
+		case 3: return variable::types::decimal;
+		case 4: return variable::types::string;
+	}
+
+	throw std::runtime_error("array has no element type yet");
+}
+
+variable array::get(
+	std::size_t _index
+) const {
+
+	check_index(_index);
+
+	switch(storage.index()) {
+
+		case 1: return 0!=std::get<1>(storage)[_index];
+		case 2: return std::get<2>(storage)[_index];
+		case 3: return std::get<3>(storage)[_index];
+		default: return std::get<4>(storage)[_index];
+	}
+}
+
+void array::set(
+	std::size_t _index,
+	const variable& _value
+) {
+
+	check_index(_index);
+	check(_value);
+
+	switch(storage.index()) {
+
+		case 1: std::get<1>(storage)[_index]=_value.get_bool(); break;
+		case 2: std::get<2>(storage)[_index]=_value.get_int(); break;
+		case 3: std::get<3>(storage)[_index]=_value.get_double(); break;
+		default: std::get<4>(storage)[_index]=_value; break;
+	}
+}
+
+void array::push(
+	const variable& _value
+) {
+
+	check(_value);
+
+	switch(storage.index()) {
+
+		case 1: std::get<1>(storage).push_back(_value.get_bool()); break;
+		case 2: std::get<2>(storage).push_back(_value.get_int()); break;
+		case 3: std::get<3>(storage).push_back(_value.get_double()); break;
+		default: std::get<4>(storage).push_back(_value); break;
+	}
+}
+
+variable array::pop() {
+
+	if(empty()) {
+
+		throw std::runtime_error("cannot pop from an empty array");
+	}
+
+	variable result=get(size()-1);
+	std::visit(
+		[](auto& _elements) {
+
+			if constexpr(!std::is_same_v<std::monostate&, decltype(_elements)>) {
+
+				_elements.pop_back();
+			}
+		},
+		storage
+	);
+
+	return result;
+}
+
+array array::slice(
+	std::size_t _begin,
+	std::size_t _end
+) const {
+
+	if(_begin > _end || _end > size()) {
+
+		throw std::runtime_error("invalid array slice ["+std::to_string(_begin)+", "+std::to_string(_end)+") for size "+std::to_string(size()));
+	}
+
+	//The slice keeps the element type even if empty.
+	array result;
+	std::visit(
+		[&](const auto& _elements) {
+
+			if constexpr(!std::is_same_v<const std::monostate&, decltype(_elements)>) {
+
+				result.storage.emplace<std::decay_t<decltype(_elements)>>(
+					std::next(std::begin(_elements), _begin),
+					std::next(std::begin(_elements), _end)
+				);
+			}
+		},
+		storage
+	);
+
+	return result;
+}
+
+void array::reserve(
+	std::size_t _size
+) {
+
+	std::visit(
+		[_size](auto& _elements) {
+
+			if constexpr(!std::is_same_v<std::monostate&, decltype(_elements)>) {
+
+				_elements.reserve(_size);
+			}
+		},
+		storage
+	);
+}
+
+void array::check(
+	const variable& _value
+) {
+
+	if(!is_typed()) {
+
+		switch(_value.type) {
+
+			case variable::types::boolean: storage.emplace<1>(); return;
+			case variable::types::integer: storage.emplace<2>(); return;
+			case variable::types::decimal: storage.emplace<3>(); return;
+			case variable::types::string: storage.emplace<4>(); return;
+			case variable::types::symbol:
+			case variable::types::array:
+			case variable::types::structure:
+			case variable::types::map:
+			case variable::types::builder:
+				throw std::runtime_error("arrays can only hold booleans, integers, doubles and strings");
+		}
+	}
+
+	if(_value.type!=get_type()) {
+
+		throw std::runtime_error("array element type mismatch");
+	}
+}
+
+void array::check_index(
+	std::size_t _index
+) const {
+
+	if(_index >= size()) {
+
+		throw std::runtime_error("array index "+std::to_string(_index)+" out of range for size "+std::to_string(size()));
+	}
+}
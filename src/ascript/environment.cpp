@@ -3,14 +3,23 @@
 #include "ascript/parser.h"
 #include "ascript/error.h"
 
+#include <algorithm>
+#include <thread>
+
 using namespace ascript;
 
+static_assert(sizeof(std::size_t) >= 8, "interpreter ids pack a 32 bit index and a 32 bit generation");
+
 environment::environment(
 	host& _host, 
-	out_interface& _out
+	out_interface& _out,
+	std::size_t _submission_capacity
 ):
 	host_instance{_host},
-	outfacility{_out}
+	outfacility{_out},
+	clock{new pausable_time_source{get_default_time_source()}},
+	submissions{new bounded_queue<run_request>{_submission_capacity}},
+	completions{new completed_queries}
 {
 
 }
@@ -35,6 +44,8 @@ void environment::load(
 
 		functions.emplace(std::make_pair(s.name, std::move(s)));
 	}
+
+	shared_functions.reset();
 }
 
 void environment::load(
@@ -49,6 +60,7 @@ void environment::load(
 	}
 
 	functions.emplace(std::make_pair(funcname, std::move(_function)));
+	shared_functions.reset();
 }
 
 void environment::unload(
@@ -61,6 +73,7 @@ void environment::unload(
 	}
 
 	functions.erase(_function_name);
+	shared_functions.reset();
 }
 
 return_value environment::run(
@@ -68,48 +81,47 @@ return_value environment::run(
 	const std::vector<variable>& _arguments
 ) {
 
-	interpreter interpreter;
-	for(const auto& pair: functions) {
-		interpreter.add_function(pair.second);
-	}
+	std::size_t id=0;
+	return run(_function_name, _arguments, id, instruction_budget::unlimited());
+}
 
-	interpreters.push_back({
-		++counter,
-		_function_name,
-		std::move(interpreter)
-	});
+return_value environment::run(
+	const std::string& _function_name, 
+	const std::vector<variable>& _arguments, 
+	std::size_t& _id
+) {
 
-	auto result=interpreters.back().interpreter.run(host_instance, outfacility, _function_name, _arguments);
-	if(!result.is_yield()) {
+	return run(_function_name, _arguments, _id, instruction_budget::unlimited());
+}
 
-		erase(interpreters.back().id);
-	}
+return_value environment::run(
+	const std::string& _function_name, 
+	const std::vector<variable>& _arguments, 
+	instruction_budget _budget
+) {
 
-	return result;
+	std::size_t id=0;
+	return run(_function_name, _arguments, id, _budget);
 }
 
 return_value environment::run(
 	const std::string& _function_name, 
 	const std::vector<variable>& _arguments, 
-	std::size_t& _id
+	std::size_t& _id,
+	instruction_budget _budget
 ) {
 
-	interpreter interpreter;
-	for(const auto& pair: functions) {
-		interpreter.add_function(pair.second);
-	}
+	auto& current=install(take_pack(_function_name));
 
-	interpreters.push_back({
-		++counter,
-		_function_name,
-		std::move(interpreter)
-	});
-
-	_id=interpreters.back().id;
-	auto result=interpreters.back().interpreter.run(host_instance, outfacility, _function_name, _arguments);
+	_id=current.id;
+	auto result=current.interpreter.run(host_instance, outfacility, _function_name, _arguments, _budget);
 	if(!result.is_yield()) {
 
-		erase(interpreters.back().id);
+		erase(_id);
+	}
+	else {
+
+		schedule(current);
 	}
 
 	return result;
@@ -119,126 +131,679 @@ return_value environment::resume(
 	std::size_t _id
 ) {
 
-	auto it=std::find_if(
-		std::begin(interpreters),
-		std::end(interpreters),
-		[_id](const pack& _pack) {
-			return _pack.id==_id;
-		}
-	);
+	return resume(_id, instruction_budget::unlimited());
+}
 
-	if(it==std::end(interpreters)) {
+return_value environment::resume(
+	std::size_t _id,
+	instruction_budget _budget
+) {
 
-		error_builder::get()<<"no interpreter with id '"<<_id<<throw_err{0, throw_err::types::user};
+	auto& current=get_pack(_id);
+	auto& interpreter=current.interpreter;
+
+	if(interpreter.is_failed()) {
+
+		error_builder::get()<<"cannot resume failed interpreter"<<throw_err{0, throw_err::types::user};
+	}
+
+	if(is_paused() && interpreter.is_timed_yield()) {
+
+		return {return_value::types::yield};
 	}
 
-	auto& interpreter=it->interpreter;
+	auto result=interpreter.resume(_budget);
+
+	if(!result.is_yield()) {
+
+		erase(_id);
+	}
+	else {
+
+		schedule(current);
+	}
+
+	return result;
+}
+
+return_value environment::resume_until(
+	std::size_t _id,
+	std::chrono::steady_clock::time_point _deadline
+) {
+
+	auto& current=get_pack(_id);
+	auto& interpreter=current.interpreter;
 
 	if(interpreter.is_failed()) {
 
 		error_builder::get()<<"cannot resume failed interpreter"<<throw_err{0, throw_err::types::user};
 	}
 
-	auto result=interpreter.resume();
+	if(is_paused() && interpreter.is_timed_yield()) {
+
+		return {return_value::types::yield};
+	}
+
+	auto result=interpreter.resume_until(_deadline);
+	stats.deadline.add(_deadline, std::chrono::steady_clock::now(), result.is_preempted());
 
 	if(!result.is_yield()) {
 
 		erase(_id);
 	}
+	else {
+
+		schedule(current);
+	}
 
 	return result;
 }
 
-void environment::erase(
-	std::size_t _id
+bool environment::submit(
+	run_request& _request
+) {
+
+	for(auto& argument : _request.arguments) {
+
+		argument=argument.clone();
+	}
+
+	_request.submitted=std::chrono::steady_clock::now();
+	return submissions->push(_request);
+}
+
+std::size_t environment::drain_submissions(
+	std::size_t _max
 ) {
 
-	auto it=std::find_if(
-		std::begin(interpreters),
-		std::end(interpreters),
-		[_id](const pack& _pack) {
-			return _pack.id==_id;
+	std::size_t count=0;
+	run_request request;
+	while(count < _max && submissions->pop(request)) {
+
+		++count;
+		run_result result{0, std::nullopt, ""};
+
+		try {
+
+			result.result=run(request.function, request.arguments, result.id);
 		}
-	);
+		catch(std::exception& e) {
 
-	interpreters.erase(it);
-} 
+			//Nobody can resume or inspect a failed request, so the 
+			//interpreter, if it was installed, goes back to the pool.
+			if(result.id) {
 
-std::vector<std::size_t> environment::get_yield_ids() const {
+				erase(result.id);
+				result.id=0;
+			}
 
-	std::vector<std::size_t> result;
+			result.error=e.what();
+		}
+
+		stats.submission_latency.add(std::chrono::steady_clock::now()-request.submitted);
+
+		if(request.on_completion) {
+
+			request.on_completion(result);
+		}
+	}
+
+	return count;
+}
+
+std::vector<resumed_interpreter> environment::signal(
+	const std::string& _event
+) {
+
+	std::vector<resumed_interpreter> result;
+
+	auto it=waiters.find(_event);
+	if(it==std::end(waiters)) {
+
+		return result;
+	}
+
+	//Taken out before resuming anything, so interpreters that wait for the
+	//same event again are left for the next signal.
+	std::vector<std::size_t> ids;
+	ids.swap(it->second);
+
+	result.reserve(ids.size());
+	for(const auto id : ids) {
+
+		//Waiters are never removed from the list, so this one might belong 
+		//to an interpreter that is gone or that waits for something else.
+		auto * p=find(id);
+		if(nullptr==p || p->waiting_on!=_event) {
+
+			continue;
+		}
 
-	std::transform(
-		std::begin(interpreters),
-		std::end(interpreters),
-		std::back_inserter(result),
-		[](const pack& _pack) {
-			return _pack.id;
+		p->waiting_on.clear();
+		if(!p->interpreter.notify(_event)) {
+
+			continue;
 		}
-	);
+
+		result.push_back(resume_entry(id, instruction_budget::unlimited()));
+	}
 
 	return result;
 }
 
-int environment::get_yield_time(
+std::vector<resumed_interpreter> environment::resume_completed() {
+
+	std::vector<resumed_interpreter> result;
+
+	std::vector<std::size_t> ids;
+	{
+		std::lock_guard<std::mutex> lock{completions->mutex};
+		ids.swap(completions->ids);
+	}
+
+	result.reserve(ids.size());
+	for(const auto id : ids) {
+
+		//The interpreter might be gone or have been resumed by id already.
+		auto * p=find(id);
+		if(nullptr==p
+			|| nullptr==p->watching
+			|| p->interpreter.get_pending_query()!=p->watching
+			|| !p->watching->is_done()
+		) {
+
+			continue;
+		}
+
+		p->watching.reset();
+		result.push_back(resume_entry(id, instruction_budget::unlimited()));
+	}
+
+	return result;
+}
+
+void environment::run_batch(
+	const std::string& _function_name,
+	const std::vector<std::vector<variable>>& _argument_sets,
+	std::vector<run_result>& _results,
+	std::size_t _threads
+) {
+
+	const auto& table=get_function_table();
+	const function * fn=table->find(_function_name);
+	if(nullptr==fn) {
+
+		error_builder::get()<<"function '"<<_function_name<<"' is not loaded"<<throw_err{0, throw_err::types::user};
+	}
+
+	const std::size_t count=_argument_sets.size();
+	_results.assign(count, run_result{0, std::nullopt, {}});
+	if(!count) {
+
+		return;
+	}
+
+	//An interpreter that yielded, with the index of its argument set.
+	struct yielded {
+
+		std::size_t             index;
+		std::unique_ptr<pack>   content;
+	};
+
+	const std::size_t thread_count=std::min(std::max<std::size_t>(_threads, 1), count);
+
+	//Runners are taken here because the pool is not thread-safe. Those that
+	//yield are replaced by fresh ones, and slots are only assigned once all
+	//threads are done.
+	std::vector<std::unique_ptr<pack>> runners;
+	runners.reserve(thread_count);
+	for(std::size_t i=0; i<thread_count; i++) {
+
+		runners.push_back(take_pack(_function_name));
+	}
+
+	std::vector<std::vector<yielded>> yields(thread_count);
+
+	//Sets spread across threads get clones, so no two threads share an 
+	//array, struct, map or builder.
+	std::vector<std::vector<variable>> clones;
+	if(thread_count > 1) {
+
+		clones.reserve(count);
+		for(const auto& set : _argument_sets) {
+
+			clones.emplace_back();
+			clones.back().reserve(set.size());
+			for(const auto& argument : set) {
+
+				clones.back().push_back(argument.clone());
+			}
+		}
+	}
+
+	const auto& sets=clones.empty() ? _argument_sets : clones;
+
+	//Same as prepare, without touching the environment.
+	auto setup=[&](pack& _pack) {
+
+		_pack.interpreter.set_time_source(*clock);
+		_pack.interpreter.set_mailbox(mailbox_ptr);
+		_pack.interpreter.set_overflow_policy(overflow);
+		_pack.interpreter.set_function_table(table);
+	};
+
+	auto work=[&](std::size_t _thread) {
+
+		const std::size_t begin=count*_thread/thread_count,
+		                  end=count*(_thread+1)/thread_count;
+
+		auto& runner=runners[_thread];
+		for(std::size_t index=begin; index<end; index++) {
+
+			if(!runner) {
+
+				runner.reset(new pack{0, _function_name, {}});
+				setup(*runner);
+			}
+
+			auto& result=_results[index];
+			try {
+
+				result.result=runner->interpreter.run(host_instance, outfacility, *fn, sets[index]);
+				if(result.result->is_yield()) {
+
+					yields[_thread].push_back({index, std::move(runner)});
+				}
+			}
+			catch(std::exception& e) {
+
+				result.error=e.what();
+				runner->interpreter.reset();
+				setup(*runner);
+			}
+		}
+	};
+
+	if(1==thread_count) {
+
+		work(0);
+	}
+	else {
+
+		std::vector<std::thread> threads;
+		threads.reserve(thread_count);
+		for(std::size_t i=0; i<thread_count; i++) {
+
+			threads.emplace_back(work, i);
+		}
+
+		for(auto& t : threads) {
+
+			t.join();
+		}
+	}
+
+	for(auto& thread_yields : yields) {
+
+		for(auto& item : thread_yields) {
+
+			auto& current=install(std::move(item.content));
+			_results[item.index].id=current.id;
+			schedule(current);
+		}
+	}
+
+	for(auto& runner : runners) {
+
+		if(runner) {
+
+			release(std::move(runner));
+		}
+	}
+}
+
+std::vector<resumed_interpreter> environment::resume_ready() {
+
+	return resume_ready(instruction_budget::unlimited());
+}
+
+std::vector<resumed_interpreter> environment::resume_ready(
+	instruction_budget _budget
+) {
+
+	std::vector<resumed_interpreter> result;
+
+	if(is_paused()) {
+
+		return result;
+	}
+
+	//Ready timers are collected before resuming anything, so interpreters
+	//that yield again are left for the next call.
+	const auto now=clock->now();
+	std::vector<timer> ready;
+	while(!timers.empty() && timers.top().release_time <= now) {
+
+		const timer current=timers.top();
+		timers.pop();
+
+		//Timers are never removed from the queue, so this one might belong to
+		//an interpreter that is gone, that yielded again or that was paused.
+		const auto * p=find(current.id);
+		if(nullptr==p
+			|| p->interpreter.get_yield_release_time()!=current.release_time
+			|| p->interpreter.is_paused()
+		) {
+
+			continue;
+		}
+
+		ready.push_back(current);
+	}
+
+	result.reserve(ready.size());
+	for(const auto& current : ready) {
+
+		result.push_back(resume_entry(current.id, _budget));
+	}
+
+	return result;
+}
+
+resumed_interpreter environment::resume_entry(
+	std::size_t _id,
+	instruction_budget _budget
+) {
+
+	try {
+
+		return {_id, resume(_id, _budget)};
+	}
+	catch(std::exception& e) {
+
+		//A failed interpreter cannot be resumed again, so it is of no use.
+		if(nullptr!=find(_id)) {
+
+			erase(_id);
+		}
+
+		return {_id, {return_value::types::nothing}, e.what()};
+	}
+}
+
+const std::shared_ptr<const function_table>& environment::get_function_table() {
+
+	if(!shared_functions) {
+
+		std::vector<const function *> index;
+		index.reserve(functions.size());
+		for(const auto& pair : functions) {
+
+			index.push_back(&pair.second);
+		}
+
+		shared_functions=std::make_shared<const function_table>(index);
+	}
+
+	return shared_functions;
+}
+
+environment::pack * environment::find(
+	std::size_t _id
+) {
+
+	const std::size_t index=_id & 0xffffffff;
+	if(index >= slots.size()) {
+
+		return nullptr;
+	}
+
+	auto& target=slots[index];
+	if(target.generation!=(_id >> 32)) {
+
+		return nullptr;
+	}
+
+	return target.content.get();
+}
+
+const environment::pack * environment::find(
 	std::size_t _id
 ) const {
 
-	const auto it=std::find_if(
-		std::begin(interpreters),
-		std::end(interpreters),
-		[_id](const pack& _pack) {
-			return _pack.id==_id;
+	return const_cast<environment *>(this)->find(_id);
+}
+
+environment::pack& environment::get_pack(
+	std::size_t _id
+) {
+
+	auto * p=find(_id);
+	if(nullptr==p) {
+
+		//Generations wrap around, so any other generation means stale.
+		const std::size_t index=_id & 0xffffffff;
+		if(index < slots.size() && slots[index].generation!=(_id >> 32)) {
+
+			error_builder::get()<<"interpreter with id '"<<_id<<"' is gone, the id is stale"<<throw_err{0, throw_err::types::user};
 		}
-	);
 
-	if(it==std::end(interpreters)) {
+		error_builder::get()<<"no interpreter with id '"<<_id<<"'"<<throw_err{0, throw_err::types::user};
+	}
+
+	return *p;
+}
+
+const environment::pack& environment::get_pack(
+	std::size_t _id
+) const {
+
+	return const_cast<environment *>(this)->get_pack(_id);
+}
+
+std::unique_ptr<environment::pack> environment::take_pack(
+	const std::string& _function_name
+) {
+
+	std::unique_ptr<pack> result;
+	if(pool.size()) {
+
+		result=std::move(pool.back());
+		pool.pop_back();
+		result->function=_function_name;
+		result->scheduled=time_source::time_point::min();
+		result->waiting_on.clear();
+		result->watching.reset();
+		++stats.pool.hits;
+	}
+	else {
 
-		error_builder::get()<<"no interpreter with id '"<<_id<<throw_err{0, throw_err::types::user};
+		result.reset(new pack{0, _function_name, {}});
+		++stats.pool.misses;
 	}
 
-	const auto& interpreter=it->interpreter;
-	return interpreter.get_yield_ms_left();
+	prepare(*result);
+	return result;
 }
 
-interpreter& environment::get_interpreter(
+void environment::prepare(
+	pack& _pack
+) {
+
+	_pack.interpreter.set_time_source(*clock);
+	_pack.interpreter.set_mailbox(mailbox_ptr);
+	_pack.interpreter.set_overflow_policy(overflow);
+	_pack.interpreter.set_function_table(get_function_table());
+}
+
+environment::pack& environment::install(
+	std::unique_ptr<pack> _pack
+) {
+
+	std::uint32_t index=0;
+	if(free_slots.size()) {
+
+		index=free_slots.back();
+		free_slots.pop_back();
+	}
+	else {
+
+		index=slots.size();
+		slots.emplace_back();
+	}
+
+	auto& target=slots[index];
+	target.content=std::move(_pack);
+	target.content->id=(std::size_t{target.generation} << 32) | index;
+	++live_count;
+	return *target.content;
+}
+
+void environment::schedule(
+	pack& _pack
+) {
+
+	//The query tells the environment when it is done, from whatever thread
+	//completes it. Only the id is passed, so nothing else is shared.
+	const auto& query=_pack.interpreter.get_pending_query();
+	if(_pack.interpreter.is_query_yield() && query!=_pack.watching) {
+
+		_pack.watching=query;
+		std::weak_ptr<completed_queries> target=completions;
+		const std::size_t id=_pack.id;
+		query->set_callback([target, id]() {
+
+			if(auto queue=target.lock()) {
+
+				std::lock_guard<std::mutex> lock{queue->mutex};
+				queue->ids.push_back(id);
+			}
+		});
+		return;
+	}
+
+	const auto& event=_pack.interpreter.get_awaited_event();
+	if(_pack.interpreter.is_event_yield() && event!=_pack.waiting_on) {
+
+		_pack.waiting_on=event;
+		waiters[event].push_back(_pack.id);
+		return;
+	}
+
+	const auto release_time=_pack.interpreter.get_yield_release_time();
+	if(!_pack.interpreter.is_timed_yield() || release_time==_pack.scheduled) {
+
+		return;
+	}
+
+	_pack.scheduled=release_time;
+	timers.push({release_time, _pack.id});
+}
+
+void environment::erase(
 	std::size_t _id
 ) {
 
-	const auto it=std::find_if(
-		std::begin(interpreters),
-		std::end(interpreters),
-		[_id](const pack& _pack) {
-			return _pack.id==_id;
-		}
-	);
+	const std::uint32_t index=_id & 0xffffffff;
+	auto& target=slots[index];
+	release(std::move(target.content));
 
-	if(it==std::end(interpreters)) {
+	//Generation 0 is skipped on wrap around so no id is ever 0.
+	if(0==++target.generation) {
 
-		error_builder::get()<<"no interpreter with id '"<<_id<<throw_err{0, throw_err::types::user};
+		target.generation=1;
 	}
 
-	return it->interpreter;
+	free_slots.push_back(index);
+	--live_count;
+} 
+
+void environment::release(
+	std::unique_ptr<pack> _pack
+) {
+
+	if(pool.size() < pool_limit) {
+
+		_pack->interpreter.reset();
+		pool.push_back(std::move(_pack));
+	}
 }
 
-void environment::pause() {
+void environment::clear() {
 
-	for(auto& _pack : interpreters) {
+	for(std::size_t index=0; index < slots.size(); index++) {
 
-		if(_pack.interpreter.is_timed_yield() && !_pack.interpreter.is_paused()) {
+		if(slots[index].content) {
 
-			_pack.interpreter.pause();
+			erase(slots[index].content->id);
 		}
 	}
+
+	timers={};
+	waiters.clear();
 }
 
-void environment::unpause() {
+std::vector<std::size_t> environment::get_yield_ids() const {
+
+	std::vector<std::size_t> result;
+	result.reserve(live_count);
 
-	for(auto& _pack : interpreters) {
+	for(const auto& target : slots) {
 
-		if(_pack.interpreter.is_timed_yield() && _pack.interpreter.is_paused()) {
+		if(target.content) {
 
-			_pack.interpreter.unpause();
+			result.push_back(target.content->id);
 		}
 	}
+
+	return result;
+}
+
+int environment::get_yield_time(
+	std::size_t _id
+) const {
+
+	return get_pack(_id).interpreter.get_yield_ms_left();
+}
+
+interpreter& environment::get_interpreter(
+	std::size_t _id
+) {
+
+	return get_pack(_id).interpreter;
+}
+
+void environment::set_pool_limit(
+	std::size_t _limit
+) {
+
+	pool_limit=_limit;
+	if(pool.size() > pool_limit) {
+
+		pool.resize(pool_limit);
+	}
+}
+
+void environment::set_time_source(
+	const time_source& _source
+) {
+
+	clock->set_source(_source);
+}
+
+void latency_histogram::add(
+	std::chrono::nanoseconds _latency
+) {
+
+	const auto microseconds=std::chrono::duration_cast<std::chrono::microseconds>(_latency).count();
+
+	std::size_t bucket=0;
+	while(bucket+1 < bucket_count && (std::chrono::microseconds::rep{1} << bucket) <= microseconds) {
+
+		++bucket;
+	}
+
+	++counts[bucket];
+	++total;
+	max=std::max(max, _latency);
 }
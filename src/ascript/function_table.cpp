@@ -0,0 +1,60 @@
+#include "ascript/function_table.h"
+#include "ascript/error.h"
+
+#include <functional>
+
+using namespace ascript;
+
+function_table::function_table(
+	const std::vector<const function *>& _functions
+) {
+
+	std::size_t capacity=1;
+	while(capacity < _functions.size()*2) {
+
+		capacity*=2;
+	}
+
+	entries.resize(capacity);
+	mask=capacity-1;
+
+	for(const auto * fn : _functions) {
+
+		if(has(fn->name)) {
+
+			error_builder::get()<<"a function named '"<<fn->name<<"' is already indexed"<<throw_err{0, throw_err::types::user};
+		}
+
+		const std::size_t hash=std::hash<std::string_view>{}(fn->name);
+		std::size_t index=hash & mask;
+		while(nullptr!=entries[index].fn) {
+
+			index=(index+1) & mask;
+		}
+
+		entries[index]={hash, fn};
+		++count;
+	}
+}
+
+const function * function_table::find(
+	std::string_view _name
+) const {
+
+	const std::size_t hash=std::hash<std::string_view>{}(_name);
+	std::size_t index=hash & mask;
+
+	//There's always at least one empty entry, so this ends.
+	while(nullptr!=entries[index].fn) {
+
+		const auto& current=entries[index];
+		if(current.hash==hash && current.fn->name==_name) {
+
+			return current.fn;
+		}
+
+		index=(index+1) & mask;
+	}
+
+	return nullptr;
+}
@@ -1,17 +1,22 @@
 #include "ascript/instructions.h"
+#include "ascript/array.h"
+#include "ascript/map.h"
+#include "ascript/structure.h"
+#include "ascript/string_builder.h"
 #include "ascript/run_context.h"
 #include "ascript/error.h"
 #include "ascript/token.h"
 
 #include <algorithm>
-#include <numeric>
+#include <charconv>
+#include <cstring>
 #include <iostream>
 
 using namespace ascript;
 
-variable ascript::solve(
+const variable& ascript::solve(
 	const variable& _var, 
-	const std::map<std::string, variable>& _symbol_table, 
+	const symbol_table& _symbol_table, 
 	int _line_number
 ) {
 
@@ -20,32 +25,229 @@ variable ascript::solve(
 		return _var;
 	}
 
-	if(!_symbol_table.count(_var.str_val)) {
+	const auto * value=_symbol_table.find(_var.get_string());
+	if(nullptr==value) {
 
-		error_builder::get()<<"undefined variable "<<_var.str_val<<throw_err{_line_number, throw_err::types::interpreter};
+		error_builder::get()<<"undefined variable "<<_var.get_string()<<throw_err{_line_number, throw_err::types::interpreter};
 	}
 
-	return _symbol_table.at(_var.str_val);
+	return *value;
 }
 
-std::vector<variable> ascript::solve(
-	const std::vector<variable>& _variables, 
-	const std::map<std::string, variable>& _symbol_table,
+//!Returns the array the variable solves to, throws if it is not one.
+static array& solve_array(
+	const variable& _var,
+	const symbol_table& _symbol_table,
+	int _line_number
+) {
+
+	auto * result=solve(_var, _symbol_table, _line_number).get_array();
+	if(nullptr==result) {
+
+		error_builder::get()<<"array expected"<<throw_err{_line_number, throw_err::types::interpreter};
+	}
+
+	return *result;
+}
+
+//!Returns the map the variable solves to, throws if it is not one.
+static map& solve_map(
+	const variable& _var,
+	const symbol_table& _symbol_table,
+	int _line_number
+) {
+
+	auto * result=solve(_var, _symbol_table, _line_number).get_map();
+	if(nullptr==result) {
+
+		error_builder::get()<<"map expected"<<throw_err{_line_number, throw_err::types::interpreter};
+	}
+
+	return *result;
+}
+
+//!Returns the struct the variable solves to, throws if it is not one of the
+//!given type.
+static structure& solve_struct(
+	const variable& _var,
+	const struct_type& _type,
+	const symbol_table& _symbol_table,
+	int _line_number
+) {
+
+	auto * result=solve(_var, _symbol_table, _line_number).get_struct();
+	if(nullptr==result || &result->get_type()!=&_type) {
+
+		error_builder::get()<<_type.name<<" struct expected"<<throw_err{_line_number, throw_err::types::interpreter};
+	}
+
+	return *result;
+}
+
+//!Returns the index the variable solves to, throws if it is not a non
+//!negative integer.
+static std::size_t solve_index(
+	const variable& _var,
+	const symbol_table& _symbol_table,
+	int _line_number
+) {
+
+	const auto& index=solve(_var, _symbol_table, _line_number);
+	if(index.type!=variable::types::integer || index.get_int() < 0) {
+
+		error_builder::get()<<"index must be a non negative integer"<<throw_err{_line_number, throw_err::types::interpreter};
+	}
+
+	return index.get_int();
+}
+
+//!Returns the string the variable solves to, throws if it is not one.
+static std::string_view solve_string(
+	const variable& _var,
+	const symbol_table& _symbol_table,
+	int _line_number
+) {
+
+	const auto& result=solve(_var, _symbol_table, _line_number);
+	if(result.type!=variable::types::string) {
+
+		error_builder::get()<<"string expected"<<throw_err{_line_number, throw_err::types::interpreter};
+	}
+
+	return result.get_string();
+}
+
+//!Returns the string builder the variable solves to, throws if it is not one.
+static string_builder& solve_builder(
+	const variable& _var,
+	const symbol_table& _symbol_table,
 	int _line_number
 ) {
 
-	std::vector<variable> result;
-	std::transform(
-		std::begin(_variables),
-		std::end(_variables),
-		std::back_inserter(result),
-		[&_symbol_table, _line_number](const variable& _var) {
+	auto * result=solve(_var, _symbol_table, _line_number).get_builder();
+	if(nullptr==result) {
+
+		error_builder::get()<<"builder expected"<<throw_err{_line_number, throw_err::types::interpreter};
+	}
+
+	return *result;
+}
+
+//!Splits a format string into pieces of text, passing each one to the 
+//!function in order. Each {} is replaced by the text of the next value, the
+//!first one being the format itself, and {{ and }} stand for braces. Throws 
+//!std::runtime_error if the format is invalid or does not match the values.
+template<typename F>
+static void format_pieces(
+	std::string_view _format,
+	const solved_arguments& _values,
+	F _piece
+) {
+
+	char buffer[string_builder::number_capacity];
+	std::size_t value=1, begin=0;
 
-			return solve(_var, _symbol_table, _line_number);
+	for(std::size_t i=0; i<_format.size(); i++) {
+
+		const char current=_format[i];
+		if('{'!=current && '}'!=current) {
+
+			continue;
 		}
-	);
 
-	return result;
+		const char next=i+1 < _format.size() ? _format[i+1] : 0;
+		_piece(_format.substr(begin, i-begin));
+
+		if(current==next) {
+
+			_piece(_format.substr(i, 1));
+		}
+		else if('{'==current && '}'==next) {
+
+			if(value==_values.size()) {
+
+				throw std::runtime_error("format has more placeholders than values");
+			}
+
+			_piece(string_builder::write(_values[value++], buffer));
+		}
+		else {
+
+			throw std::runtime_error("unmatched brace in format, use {{ and }} for braces");
+		}
+
+		begin=++i+1;
+	}
+
+	_piece(_format.substr(begin));
+
+	if(value!=_values.size()) {
+
+		throw std::runtime_error("format has more values than placeholders");
+	}
+}
+
+//!Reads a whole string as a number, returns false if there is anything else.
+template<typename T>
+static bool parse_number(
+	std::string_view _str,
+	T& _result
+) {
+
+	const auto end=_str.data()+_str.size();
+	const auto parsed=std::from_chars(_str.data(), end, _result);
+	return std::errc{}==parsed.ec && end==parsed.ptr;
+}
+
+//!Throws if the value is not an integer or a double.
+static void check_numeric(
+	const variable& _var,
+	int _line_number
+) {
+
+	if(_var.type!=variable::types::integer && _var.type!=variable::types::decimal) {
+
+		error_builder::get()<<"numeric value expected"<<throw_err{_line_number, throw_err::types::interpreter};
+	}
+}
+
+solved_arguments::solved_arguments(
+	const std::vector<variable>& _variables, 
+	const symbol_table& _symbol_table,
+	int _line_number
+):
+	count{_variables.size()}
+{
+
+	//Very long argument lists are the only case where we hit the heap.
+	if(count > inline_capacity) {
+
+		overflow.reserve(count);
+		for(const auto& var : _variables) {
+
+			overflow.push_back(&solve(var, _symbol_table, _line_number));
+		}
+
+		return;
+	}
+
+	std::size_t index=0;
+	for(const auto& var : _variables) {
+
+		storage[index++]=&solve(var, _symbol_table, _line_number);
+	}
+}
+
+void solved_arguments::copy_to(
+	std::vector<variable>& _target
+) const {
+
+	//Clearing keeps whatever capacity the target vector already had.
+	_target.clear();
+	for(const auto& var : *this) {
+
+		_target.push_back(var);
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -111,7 +313,7 @@ void instruction_out::run(
 	run_context& _ctx
 ) const {
 
-	for(const auto& arg : solve(arguments, _ctx.symbol_table, line_number)) {
+	for(const auto& arg : solved_arguments{arguments, *_ctx.symbol_table, line_number}) {
 
 		_ctx.out_facility->out(arg);
 	}
@@ -141,16 +343,16 @@ void instruction_host_set::run(
 
 	//Arg count was checked at parse time.
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
-	const auto symbol=solved.at(0);
-	const auto value=solved.at(1);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	const auto& symbol=solved[0];
+	const auto& value=solved[1];
 
 	if(symbol.type!=variable::types::string) {
 
 		error_builder::get()<<"host_set expects first argument to be a string"<<throw_err{line_number, throw_err::types::interpreter};
 	}
 
-	_ctx.host_ptr->host_set(symbol.str_val, value);
+	_ctx.host_ptr->host_set(std::string{symbol.get_string()}, value);
 }
 
 void instruction_host_add::run(
@@ -159,11 +361,11 @@ void instruction_host_add::run(
 
 	//Arg count was checked at parse time.
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
-	const auto symbol=solved.at(0);
-	const auto value=solved.at(1);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	const auto& symbol=solved[0];
+	const auto& value=solved[1];
 
-	_ctx.host_ptr->host_add(symbol.str_val, value);
+	_ctx.host_ptr->host_add(std::string{symbol.get_string()}, value);
 }
 
 void instruction_host_delete::run(
@@ -172,17 +374,168 @@ void instruction_host_delete::run(
 
 	//Arg count was checked at parse time.
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
-	const auto symbol=solved.at(0);
+	const auto& symbol=solve(arguments[0], *_ctx.symbol_table, line_number);
 
-	_ctx.host_ptr->host_delete(symbol.str_val);
+	_ctx.host_ptr->host_delete(std::string{symbol.get_string()});
 }
 
 void instruction_host_do::run(
 	run_context& _ctx
 ) const {
 
-	_ctx.host_ptr->host_do(solve(arguments, _ctx.symbol_table, line_number));
+	solved_arguments{arguments, *_ctx.symbol_table, line_number}.copy_to(_ctx.arguments);
+	_ctx.host_ptr->host_do(_ctx.arguments);
+}
+
+void instruction_array_set::run(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+
+	auto& target=solve_array(arguments[0], *_ctx.symbol_table, line_number);
+	const auto index=solve_index(arguments[1], *_ctx.symbol_table, line_number);
+	const auto& value=solve(arguments[2], *_ctx.symbol_table, line_number);
+
+	try {
+
+		target.set(index, value);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+}
+
+void instruction_array_push::run(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	auto& target=solve_array(solved.front(), *_ctx.symbol_table, line_number);
+
+	try {
+
+		for(auto it=std::next(std::begin(solved)); it!=std::end(solved); ++it) {
+
+			target.push(*it);
+		}
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+}
+
+void instruction_struct_set::run(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time, the field was resolved then.
+
+	auto& target=solve_struct(arguments[0], *type, *_ctx.symbol_table, line_number);
+	const auto& value=solve(arguments[1], *_ctx.symbol_table, line_number);
+
+	try {
+
+		target.set(field, value);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+}
+
+void instruction_map_set::run(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+
+	auto& target=solve_map(arguments[0], *_ctx.symbol_table, line_number);
+	const auto& key=solve(arguments[1], *_ctx.symbol_table, line_number);
+	const auto& value=solve(arguments[2], *_ctx.symbol_table, line_number);
+
+	try {
+
+		target.set(key, value);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+}
+
+void instruction_map_erase::run(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	auto& target=solve_map(solved.front(), *_ctx.symbol_table, line_number);
+
+	try {
+
+		for(auto it=std::next(std::begin(solved)); it!=std::end(solved); ++it) {
+
+			target.erase(*it);
+		}
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+}
+
+void instruction_builder_append::run(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	auto& target=solve_builder(solved.front(), *_ctx.symbol_table, line_number);
+
+	try {
+
+		for(auto it=std::next(std::begin(solved)); it!=std::end(solved); ++it) {
+
+			target.append(*it);
+		}
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+}
+
+void instruction_post::run(
+	run_context& _ctx
+) const {
+
+	if(nullptr==_ctx.mailbox_ptr) {
+
+		error_builder::get()<<"post cannot be used, there is no mailbox"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	const auto& key=solved[0];
+	const auto& function_name=solved[1];
+
+	if(key.type!=variable::types::integer || key.get_int() < 0) {
+
+		error_builder::get()<<"post expects a non negative integer key"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	if(function_name.type!=variable::types::string) {
+
+		error_builder::get()<<"post expects a string function name"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	_ctx.arguments.clear();
+	for(auto it=std::next(std::begin(solved), 2); it!=std::end(solved); ++it) {
+
+		_ctx.arguments.push_back(*it);
+	}
+
+	_ctx.mailbox_ptr->post(key.get_int(), std::string{function_name.get_string()}, _ctx.arguments);
 }
 
 void instruction_is_equal::run(
@@ -196,11 +549,11 @@ variable instruction_is_equal::evaluate(
 	run_context& _ctx
 ) const {
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 	const auto& first=solved.front();
 
 	return std::all_of(
-		std::begin(solved)+1,
+		std::next(std::begin(solved)),
 		std::end(solved),
 		[&first](const variable& _var) {
 
@@ -220,7 +573,7 @@ variable instruction_generate_value::evaluate(
 	run_context& _ctx
 ) const {
 
-	return solve(arguments[0], _ctx.symbol_table, line_number);
+	return solve(arguments[0], *_ctx.symbol_table, line_number);
 }
 
 void instruction_copy_from_return_register::run(
@@ -240,10 +593,11 @@ variable instruction_copy_from_return_register::evaluate(
 		<<throw_err{line_number, throw_err::types::interpreter};
 	}
 
-	_ctx.value=*(_ctx.return_register);
+	//The register is emptied anyway, so its value can be moved out.
+	variable result=std::move(*(_ctx.return_register));
 	_ctx.return_register.reset();
 
-	return _ctx.value;
+	return result;
 }
 
 void instruction_is_lesser_than::run(
@@ -257,14 +611,14 @@ variable instruction_is_lesser_than::evaluate(
 	run_context& _ctx
 ) const {
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 
 	try {
 
-		const auto first=solved.front();
+		const auto& first=solved.front();
 
 		return std::all_of(
-			std::begin(solved)+1,
+			std::next(std::begin(solved)),
 			std::end(solved),
 			[&first](const variable& _var) {
 				return first < _var;
@@ -290,14 +644,14 @@ variable instruction_is_greater_than::evaluate(
 	run_context& _ctx
 ) const {
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 
 	try {
 
-		const auto first=solved.front();
+		const auto& first=solved.front();
 
 		return std::all_of(
-			std::begin(solved)+1,
+			std::next(std::begin(solved)),
 			std::end(solved),
 			[&first](const variable& _var) {
 				return first > _var;
@@ -323,16 +677,27 @@ variable instruction_add::evaluate(
 	run_context& _ctx
 ) const {
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 
-	return std::accumulate(
-		std::begin(solved)+1,
-		std::end(solved),
-		solved.front(),
-		[](const variable& _a, const variable& _b) {
-			return _a+_b;
-		}
-	);
+	//Operates in place on a single result.
+	variable result{solved.front()};
+
+	try {
+
+		std::for_each(
+			std::next(std::begin(solved)),
+			std::end(solved),
+			[&result, &_ctx](const variable& _operand) {
+				result.add(_operand, _ctx.overflow);
+			}
+		);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return result;
 }
 
 void instruction_concatenate::run(
@@ -346,16 +711,30 @@ variable instruction_concatenate::evaluate(
 	run_context& _ctx
 ) const {
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	//Parts are solved twice, once to add up the length of the result and
+	//once to copy them, so the result is allocated once and nothing else 
+	//is, regardless of the number of parts.
+	std::size_t length=0;
+	for(const auto& arg : arguments) {
+
+		const auto& part=solve(arg, *_ctx.symbol_table, line_number);
+		if(part.type!=variable::types::string) {
 
-	return std::accumulate(
-		std::begin(solved)+1,
-		std::end(solved),
-		solved.front(),
-		[](const variable& _a, const variable& _b) {
-			return _a.concatenate(_b);
+			error_builder::get()<<"concatenation is only applicable to string types"<<throw_err{line_number, throw_err::types::interpreter};
 		}
-	);
+
+		length+=part.get_string().size();
+	}
+
+	return variable::build_string(length, [&](char * _out) {
+
+		for(const auto& arg : arguments) {
+
+			const auto part=solve(arg, *_ctx.symbol_table, line_number).get_string();
+			std::memcpy(_out, part.data(), part.size());
+			_out+=part.size();
+		}
+	});
 }
 
 void instruction_substract::run(
@@ -369,44 +748,303 @@ variable instruction_substract::evaluate(
 	run_context& _ctx
 ) const {
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 
-	return std::accumulate(
-		std::begin(solved)+1,
-		std::end(solved),
-		solved.front(),
-		[](const variable& _a, const variable& _b) {
-			return _a-_b;
-		}
-	);
+	//Operates in place on a single result.
+	variable result{solved.front()};
+
+	try {
+
+		std::for_each(
+			std::next(std::begin(solved)),
+			std::end(solved),
+			[&result, &_ctx](const variable& _operand) {
+				result.substract(_operand, _ctx.overflow);
+			}
+		);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return result;
 }
 
-void instruction_host_has::run(
+void instruction_multiply::run(
 	run_context& _ctx
 ) const {
 
 	_ctx.value=evaluate(_ctx);
 }
 
-variable instruction_host_has::evaluate(
+variable instruction_multiply::evaluate(
 	run_context& _ctx
 ) const {
 
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 
-	return std::all_of(
-		std::begin(solved),
-		std::end(solved),
-		[&_ctx, this](const variable& _var) {
+	//Operates in place on a single result.
+	variable result{solved.front()};
 
-			if(_var.type!=variable::types::string) {
+	try {
+
+		std::for_each(
+			std::next(std::begin(solved)),
+			std::end(solved),
+			[&result, &_ctx](const variable& _operand) {
+				result.multiply(_operand, _ctx.overflow);
+			}
+		);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return result;
+}
+
+void instruction_divide::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_divide::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+
+	//Operates in place on a single result.
+	variable result{solved.front()};
+
+	try {
+
+		std::for_each(
+			std::next(std::begin(solved)),
+			std::end(solved),
+			[&result, &_ctx](const variable& _operand) {
+				result.divide(_operand, _ctx.overflow);
+			}
+		);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return result;
+}
+
+void instruction_modulo::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_modulo::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+
+	//Operates in place on a single result.
+	variable result{solved.front()};
+
+	try {
+
+		std::for_each(
+			std::next(std::begin(solved)),
+			std::end(solved),
+			[&result](const variable& _operand) {
+				result.modulo(_operand);
+			}
+		);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return result;
+}
+
+void instruction_min::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_min::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	check_numeric(solved.front(), line_number);
+
+	try {
+
+		const auto * result=&solved.front();
+		for(const auto& var : solved) {
+
+			if(var < *result) {
+
+				result=&var;
+			}
+		}
+
+		return *result;
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return false; //Shut up compiler.
+}
+
+void instruction_max::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_max::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	check_numeric(solved.front(), line_number);
+
+	try {
+
+		const auto * result=&solved.front();
+		for(const auto& var : solved) {
+
+			if(var > *result) {
+
+				result=&var;
+			}
+		}
+
+		return *result;
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return false; //Shut up compiler.
+}
+
+void instruction_abs::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_abs::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+
+	const auto& value=solve(arguments[0], *_ctx.symbol_table, line_number);
+	check_numeric(value, line_number);
+
+	variable zero=variable::types::integer==value.type ? variable{0} : variable{0.};
+	if(!(value < zero)) {
+
+		return value;
+	}
+
+	//The lowest integer has no positive counterpart. Wrapping around would 
+	//give back a negative value, so this fails under any policy, like 
+	//dividing by 0 does.
+	try {
+
+		return zero.substract(value, overflow_policy::check);
+	}
+	catch(std::runtime_error&) {
+
+		error_builder::get()<<"integer overflow in abs"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return false; //Shut up compiler.
+}
+
+void instruction_clamp::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_clamp::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	const auto& value=solved.front();
+	const auto& lowest=*std::next(std::begin(solved));
+	const auto& highest=*std::next(std::begin(solved), 2);
+
+	try {
+
+		if(!(lowest > highest)) {
+
+			if(value < lowest) {
+
+				return lowest;
+			}
+
+			return value > highest ? highest : value;
+		}
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	error_builder::get()<<"clamp expects the lowest value not to be greater than the highest"<<throw_err{line_number, throw_err::types::interpreter};
+	return false; //Shut up compiler.
+}
+
+void instruction_host_has::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_host_has::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+
+	return std::all_of(
+		std::begin(solved),
+		std::end(solved),
+		[&_ctx, this](const variable& _var) {
+
+			if(_var.type!=variable::types::string) {
 
 				error_builder::get()
 					<<"host_has must be called with strings"
 					<<throw_err{line_number, throw_err::types::host};
 			}
 
-			return _ctx.host_ptr->host_has(_var.str_val);
+			return _ctx.host_ptr->host_has(std::string{_var.get_string()});
 		}
 	);
 }
@@ -422,7 +1060,7 @@ variable instruction_is_int::evaluate(
 	run_context& _ctx
 ) const {
 
-	const auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 	return std::all_of(
 		std::begin(solved),
 		std::end(solved),
@@ -441,7 +1079,7 @@ variable instruction_is_bool::evaluate(
 	run_context& _ctx
 ) const {
 
-	const auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 	return std::all_of(
 		std::begin(solved),
 		std::end(solved),
@@ -460,7 +1098,7 @@ variable instruction_is_double::evaluate(
 	run_context& _ctx
 ) const {
 
-	const auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 
 	return std::all_of(
 		std::begin(solved),
@@ -480,7 +1118,7 @@ variable instruction_is_string::evaluate(
 	run_context& _ctx
 ) const {
 
-	const auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
 	return std::all_of(
 		std::begin(solved),
 		std::end(solved),
@@ -488,390 +1126,1477 @@ variable instruction_is_string::evaluate(
 	);
 }
 
-void instruction_host_get::run(
+void instruction_string_length::run(
 	run_context& _ctx
 ) const {
 
 	_ctx.value=evaluate(_ctx);
 }
 
-variable instruction_host_get::evaluate(
+variable instruction_string_length::evaluate(
 	run_context& _ctx
 ) const {
 
-	//Argument count is made at parse time.
-	auto solved=solve(arguments, _ctx.symbol_table, line_number);
+	//Arg count was checked at parse time.
+	return (std::int64_t)solve_string(arguments[0], *_ctx.symbol_table, line_number).size();
+}
 
-	auto arg=solved.front();
-	if(arg.type!=variable::types::string) {
+void instruction_substring::run(
+	run_context& _ctx
+) const {
 
-		error_builder::get()
-			<<"host_get must be called with strings"
-			<<throw_err{line_number, throw_err::types::host};
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_substring::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto text=solve_string(arguments[0], *_ctx.symbol_table, line_number);
+	const auto begin=solve_index(arguments[1], *_ctx.symbol_table, line_number);
+	const auto end=3==arguments.size() 
+		? solve_index(arguments[2], *_ctx.symbol_table, line_number)
+		: text.size();
+
+	if(begin > end || end > text.size()) {
+
+		error_builder::get()<<"invalid substring ["<<begin<<", "<<end<<") for length "<<text.size()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return text.substr(begin, end-begin);
+}
+
+void instruction_string_find::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_string_find::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto text=solve_string(arguments[0], *_ctx.symbol_table, line_number);
+	const auto needle=solve_string(arguments[1], *_ctx.symbol_table, line_number);
+	const auto from=3==arguments.size() 
+		? solve_index(arguments[2], *_ctx.symbol_table, line_number)
+		: 0;
+
+	const auto index=text.find(needle, from);
+	return std::string_view::npos==index ? std::int64_t{-1} : (std::int64_t)index;
+}
+
+void instruction_starts_with::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_starts_with::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto text=solve_string(arguments[0], *_ctx.symbol_table, line_number);
+	const auto prefix=solve_string(arguments[1], *_ctx.symbol_table, line_number);
+
+	return text.size() >= prefix.size() && 0==text.compare(0, prefix.size(), prefix);
+}
+
+void instruction_string_compare::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_string_compare::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto first=solve_string(arguments[0], *_ctx.symbol_table, line_number);
+	const auto second=solve_string(arguments[1], *_ctx.symbol_table, line_number);
+
+	const int order=first.compare(second);
+	return order < 0 ? -1 : (order > 0 ? 1 : 0);
+}
+
+void instruction_to_int::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_to_int::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto& value=solve(arguments[0], *_ctx.symbol_table, line_number);
+
+	std::int64_t result{0};
+	switch(value.type) {
+
+		case variable::types::integer:
+			return value;
+		case variable::types::string:
+			if(parse_number(value.get_string(), result)) {
+
+				return result;
+			}
+		break;
+		case variable::types::decimal:
+			//Truncates towards zero, if the integer part fits.
+			if(value.get_double() >= -9223372036854775808. && value.get_double() < 9223372036854775808.) {
+
+				return (std::int64_t)value.get_double();
+			}
+		break;
+		default:
+			error_builder::get()<<"to_int expects a string, an integer or a double"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	if(2==arguments.size()) {
+
+		return solve(arguments[1], *_ctx.symbol_table, line_number);
+	}
+
+	error_builder::get()<<"cannot convert "<<value<<" to an integer"<<throw_err{line_number, throw_err::types::interpreter};
+	return false; //Shut up compiler.
+}
+
+void instruction_to_double::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_to_double::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto& value=solve(arguments[0], *_ctx.symbol_table, line_number);
+
+	double result{0.};
+	switch(value.type) {
+
+		case variable::types::decimal:
+			return value;
+		case variable::types::integer:
+			return (double)value.get_int();
+		case variable::types::string:
+			if(parse_number(value.get_string(), result)) {
+
+				return result;
+			}
+		break;
+		default:
+			error_builder::get()<<"to_double expects a string, an integer or a double"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	if(2==arguments.size()) {
+
+		return solve(arguments[1], *_ctx.symbol_table, line_number);
+	}
+
+	error_builder::get()<<"cannot convert "<<value<<" to a double"<<throw_err{line_number, throw_err::types::interpreter};
+	return false; //Shut up compiler.
+}
+
+void instruction_to_string::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_to_string::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto& value=solve(arguments[0], *_ctx.symbol_table, line_number);
+
+	if(variable::types::string==value.type) {
+
+		return value;
+	}
+
+	try {
+
+		//Numbers are written to the stack first, they fit inline.
+		char buffer[string_builder::number_capacity];
+		return string_builder::write(value, buffer);
+	}
+	catch(std::runtime_error&) {
+
+		error_builder::get()<<"to_string expects a boolean, an integer, a double or a string"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return false; //Shut up compiler.
+}
+
+void instruction_format::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_format::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	if(solved.front().type!=variable::types::string) {
+
+		error_builder::get()<<"format expects a string first"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	const auto format=solved.front().get_string();
+
+	//Measures first, so the result is allocated once. Anything wrong with
+	//the format shows here, the second pass cannot fail.
+	std::size_t length=0;
+	try {
+
+		format_pieces(format, solved, [&length](std::string_view _piece) {length+=_piece.size();});
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return variable::build_string(length, [&](char * _out) {
+
+		format_pieces(format, solved, [&_out](std::string_view _piece) {
+
+			if(_piece.size()) {
+
+				std::memcpy(_out, _piece.data(), _piece.size());
+				_out+=_piece.size();
+			}
+		});
+	});
+}
+
+void instruction_builder::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_builder::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	string_builder result;
+
+	try {
+
+		for(const auto& value : solved) {
+
+			result.append(value);
+		}
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return variable{std::move(result)};
+}
+
+void instruction_builder_freeze::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_builder_freeze::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	return solve_builder(arguments[0], *_ctx.symbol_table, line_number).freeze();
+}
+
+void instruction_is_array::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_is_array::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	return std::all_of(
+		std::begin(solved),
+		std::end(solved),
+		[](const variable& _var) {return _var.type==variable::types::array;}
+	);
+}
+
+void instruction_array::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_array::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+
+	array result;
+	try {
+
+		for(const auto& value : solved) {
+
+			result.push(value);
+
+			//The storage exists once the first value sets the type.
+			if(1==result.size()) {
+				result.reserve(solved.size());
+			}
+		}
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return variable{std::move(result)};
+}
+
+void instruction_array_size::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_array_size::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	return (std::int64_t)solve_array(arguments[0], *_ctx.symbol_table, line_number).size();
+}
+
+void instruction_array_get::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_array_get::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto& source=solve_array(arguments[0], *_ctx.symbol_table, line_number);
+	const auto index=solve_index(arguments[1], *_ctx.symbol_table, line_number);
+
+	try {
+
+		return source.get(index);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return false; //Shut up compiler.
+}
+
+void instruction_array_pop::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_array_pop::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	auto& source=solve_array(arguments[0], *_ctx.symbol_table, line_number);
+
+	try {
+
+		return source.pop();
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return false; //Shut up compiler.
+}
+
+void instruction_array_slice::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_array_slice::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto& source=solve_array(arguments[0], *_ctx.symbol_table, line_number);
+	const auto begin=solve_index(arguments[1], *_ctx.symbol_table, line_number),
+	           end=solve_index(arguments[2], *_ctx.symbol_table, line_number);
+
+	try {
+
+		return source.slice(begin, end);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return false; //Shut up compiler.
+}
+
+void instruction_is_map::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_is_map::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	return std::all_of(
+		std::begin(solved),
+		std::end(solved),
+		[](const variable& _var) {return _var.type==variable::types::map;}
+	);
+}
+
+void instruction_map::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_map::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time, keys and values come in pairs.
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+
+	map result;
+	try {
+
+		result.reserve(solved.size()/2);
+		for(std::size_t i=0; i<solved.size(); i+=2) {
+
+			result.set(solved[i], solved[i+1]);
+		}
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return variable{std::move(result)};
+}
+
+void instruction_map_size::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_map_size::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	return (std::int64_t)solve_map(arguments[0], *_ctx.symbol_table, line_number).size();
+}
+
+void instruction_map_get::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_map_get::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time.
+	const auto& source=solve_map(arguments[0], *_ctx.symbol_table, line_number);
+	const auto& key=solve(arguments[1], *_ctx.symbol_table, line_number);
+
+	const variable * value{nullptr};
+	try {
+
+		value=source.find(key);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	if(nullptr!=value) {
+
+		return *value;
+	}
+
+	if(3==arguments.size()) {
+
+		return solve(arguments[2], *_ctx.symbol_table, line_number);
+	}
+
+	error_builder::get()<<"map has no key "<<key<<throw_err{line_number, throw_err::types::interpreter};
+	return false; //Shut up compiler.
+}
+
+void instruction_map_has::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_map_has::evaluate(
+	run_context& _ctx
+) const {
+
+	const solved_arguments solved{arguments, *_ctx.symbol_table, line_number};
+	const auto& source=solve_map(solved.front(), *_ctx.symbol_table, line_number);
+
+	try {
+
+		return std::all_of(
+			std::next(std::begin(solved)),
+			std::end(solved),
+			[&source](const variable& _key) {return source.has(_key);}
+		);
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return false; //Shut up compiler.
+}
+
+void instruction_struct_new::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_struct_new::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time: either none or one per field.
+	variable result{type};
+	auto& fields=*result.get_struct();
+
+	try {
+
+		std::size_t index=0;
+		for(const auto& value : solved_arguments{arguments, *_ctx.symbol_table, line_number}) {
+
+			fields.set(index++, value);
+		}
+	}
+	catch(std::runtime_error& e) {
+
+		error_builder::get()<<e.what()<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	return result;
+}
+
+void instruction_struct_get::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_struct_get::evaluate(
+	run_context& _ctx
+) const {
+
+	//Arg count was checked at parse time, the field was resolved then.
+	return solve_struct(arguments[0], *type, *_ctx.symbol_table, line_number).get(field);
+}
+
+void instruction_host_get::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_host_get::evaluate(
+	run_context& _ctx
+) const {
+
+	//Argument count is made at parse time.
+	const auto& arg=solve(arguments[0], *_ctx.symbol_table, line_number);
+
+	if(arg.type!=variable::types::string) {
+
+		error_builder::get()
+			<<"host_get must be called with strings"
+			<<throw_err{line_number, throw_err::types::host};
+	}
+
+	return _ctx.host_ptr->host_get(std::string{arg.get_string()});
+}
+
+void instruction_host_query::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=evaluate(_ctx);
+}
+
+variable instruction_host_query::evaluate(
+	run_context& _ctx
+) const {
+
+	solved_arguments{arguments, *_ctx.symbol_table, line_number}.copy_to(_ctx.arguments);
+	return _ctx.host_ptr->host_query(_ctx.arguments);
+}
+
+void instruction_host_query_async::run(
+	run_context& _ctx
+) const {
+
+	solved_arguments{arguments, *_ctx.symbol_table, line_number}.copy_to(_ctx.arguments);
+	auto query=_ctx.host_ptr->host_query_async(_ctx.arguments);
+	if(nullptr==query) {
+
+		error_builder::get()<<"host_query_async returned no query"<<throw_err{line_number, throw_err::types::host};
+	}
+
+	//Answered right away, no need to wait.
+	if(query->is_done()) {
+
+		if(query->is_failed()) {
+
+			error_builder::get()<<"host query failed: "<<query->get_error()<<throw_err{line_number, throw_err::types::host};
+		}
+
+		_ctx.return_register=query->get_value();
+		return;
+	}
+
+	_ctx.pending_query=std::move(query);
+	_ctx.signal=run_context::signals::sigyield;
+	_ctx.value=0;
+}
+
+void instruction_function_call::run(
+	run_context& _ctx
+) const {
+
+	_ctx.value=function_name;
+	solved_arguments{arguments, *_ctx.symbol_table, line_number}.copy_to(_ctx.arguments);
+	_ctx.signal=run_context::signals::sigcall;
+}
+
+void instruction_declaration_dynamic::run(
+	run_context& _ctx
+) const {
+
+	if(_ctx.symbol_table->has(identifier)) {
+
+		error_builder::get()<<"identifier already exists for declaration"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	_ctx.symbol_table->insert(
+		identifier, 
+		function->evaluate(_ctx)
+	);
+}
+
+void instruction_assignment_dynamic::run(
+	run_context& _ctx
+) const {
+
+	auto * target=_ctx.symbol_table->find(identifier);
+	if(nullptr==target) {
+
+		error_builder::get()<<"identifier does not exist for assignment"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	auto val=function->evaluate(_ctx);
+
+	if(val.type!=target->type) {
+
+		error_builder::get()<<"type mismatch for assignment"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	*target=std::move(val);
+}
+
+void instruction_return::run(
+	run_context& _ctx
+) const {
+
+	if(returned_value) {
+
+		_ctx.signal=run_context::signals::sigreturnval;
+		_ctx.return_register=solve(*returned_value, *_ctx.symbol_table, line_number);
+
+	}
+	else {
+
+		_ctx.signal=run_context::signals::sigreturn;
+		_ctx.return_register.reset();
+	}
+}
+
+void instruction_yield::run(
+	run_context& _ctx
+) const {
+
+	_ctx.signal=run_context::signals::sigyield;
+
+	const auto& yieldtime=solve(yield_ms, *_ctx.symbol_table, line_number);
+	if(yieldtime.type!=variable::types::integer) {
+
+		error_builder::get()<<"yield time must solve to an integer value"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	_ctx.value=yieldtime;
+}
+
+void instruction_yield_until::run(
+	run_context& _ctx
+) const {
+
+	_ctx.signal=run_context::signals::sigyield;
+
+	const auto& name=solve(event, *_ctx.symbol_table, line_number);
+	if(name.type!=variable::types::string || name.get_string().empty()) {
+
+		error_builder::get()<<"yield until event must solve to a non empty string"<<throw_err{line_number, throw_err::types::interpreter};
+	}
+
+	_ctx.value=name;
+}
+
+void instruction_break::run(
+	run_context& _ctx
+) const {
+
+	_ctx.signal=run_context::signals::sigbreak;
+}
+
+void instruction_exit::run(
+	run_context& _ctx
+) const {
+
+	_ctx.signal=run_context::signals::sigexit;
+}
+
+void instruction_conditional_branch::run(
+	run_context& _ctx
+) const {
+
+	for(const auto& branch : branches) {
+
+		//This is the else...
+		if(!branch.function) {
+
+			_ctx.signal=run_context::signals::sigjump;
+			_ctx.value=branch.target_block_index;
+			return;
+		}
+
+		//This is anything that can be evaluated...
+		auto val=branch.function->evaluate(_ctx);
+		if(val.type!=variable::types::boolean) {
+
+			error_builder::get()<<"evaluation type mismatch, must be boolean values"<<throw_err{branch.line_number, throw_err::types::interpreter};
+		}
+
+		//TODO: is this some kind of XOR?
+		if(!branch.negated && val.get_bool()) {
+
+			_ctx.signal=run_context::signals::sigjump;
+			_ctx.value=branch.target_block_index;
+			return;
+		}
+		else if(branch.negated && !val.get_bool()) {
+
+			_ctx.signal=run_context::signals::sigjump;
+			_ctx.value=branch.target_block_index;
+			return;
+		}
+	}
+}
+
+void instruction_loop::run(
+	run_context& _ctx
+) const {
+
+	_ctx.signal=run_context::signals::sigjump;
+	_ctx.value=target_block_index;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Format out methods...
+
+void instruction_out::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"out[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_fail::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"fail[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_host_set::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"host_set[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_host_add::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"host_add[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_host_delete::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"host_delete[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_host_do::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"host_do[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_post::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"post[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_is_equal::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"is_equal[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_generate_value::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"generate_value[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_copy_from_return_register::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"copy_from_return_register[]";
+}
+
+void instruction_is_greater_than::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"is_greater_than[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_is_lesser_than::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"is_lesser_than[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_add::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"add[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_multiply::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"multiply[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_divide::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"divide[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_modulo::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"modulo[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_min::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"min[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_max::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"max[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_abs::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"abs[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
+void instruction_clamp::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"clamp[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
 	}
-
-	return _ctx.host_ptr->host_get(arg.str_val);
+	_stream<<"]";
 }
 
-void instruction_host_query::run(
-	run_context& _ctx
+void instruction_string_length::format_out(
+	std::ostream& _stream
 ) const {
 
-	_ctx.value=evaluate(_ctx);
+	_stream<<"string_length[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
 }
 
-variable instruction_host_query::evaluate(
-	run_context& _ctx
+void instruction_substring::format_out(
+	std::ostream& _stream
 ) const {
 
-	return _ctx.host_ptr->host_query(solve(arguments, _ctx.symbol_table, line_number));
+	_stream<<"substring[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
 }
 
-void instruction_function_call::run(
-	run_context& _ctx
+void instruction_string_find::format_out(
+	std::ostream& _stream
 ) const {
 
-	_ctx.value=function_name;
-	_ctx.arguments=solve(arguments, _ctx.symbol_table, line_number);
-	_ctx.signal=run_context::signals::sigcall;
+	_stream<<"string_find[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
 }
 
-void instruction_declaration_dynamic::run(
-	run_context& _ctx
+void instruction_starts_with::format_out(
+	std::ostream& _stream
 ) const {
 
-	if(_ctx.symbol_table.count(identifier)) {
-
-		error_builder::get()<<"identifier already exists for declaration"<<throw_err{line_number, throw_err::types::interpreter};
+	_stream<<"starts_with[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
 	}
-
-	_ctx.symbol_table.insert(
-		std::make_pair(
-			identifier, 
-			function->evaluate(_ctx)
-		)
-	);
+	_stream<<"]";
 }
 
-void instruction_assignment_dynamic::run(
-	run_context& _ctx
+void instruction_string_compare::format_out(
+	std::ostream& _stream
 ) const {
 
-	if(!_ctx.symbol_table.count(identifier)) {
-
-		error_builder::get()<<"identifier does not exist for assignment"<<throw_err{line_number, throw_err::types::interpreter};
+	_stream<<"string_compare[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
 	}
+	_stream<<"]";
+}
 
-	auto val=function->evaluate(_ctx);
-
-	if(val.type!=_ctx.symbol_table.at(identifier).type) {
+void instruction_to_int::format_out(
+	std::ostream& _stream
+) const {
 
-		error_builder::get()<<"type mismatch for assignment"<<throw_err{line_number, throw_err::types::interpreter};
+	_stream<<"to_int[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
 	}
-
-	_ctx.symbol_table.at(identifier)=val;
+	_stream<<"]";
 }
 
-void instruction_return::run(
-	run_context& _ctx
+void instruction_to_double::format_out(
+	std::ostream& _stream
 ) const {
 
-	if(returned_value) {
-
-		_ctx.signal=run_context::signals::sigreturnval;
-		_ctx.return_register=solve(*returned_value, _ctx.symbol_table, line_number);
-
-	}
-	else {
-
-		_ctx.signal=run_context::signals::sigreturn;
-		_ctx.return_register.reset();
+	_stream<<"to_double[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
 	}
+	_stream<<"]";
 }
 
-void instruction_yield::run(
-	run_context& _ctx
+void instruction_to_string::format_out(
+	std::ostream& _stream
 ) const {
 
-	_ctx.signal=run_context::signals::sigyield;
+	_stream<<"to_string[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
 
-	auto yieldtime=solve(yield_ms, _ctx.symbol_table, line_number);
-	if(yieldtime.type!=variable::types::integer) {
+void instruction_format::format_out(
+	std::ostream& _stream
+) const {
 
-		error_builder::get()<<"yield time must solve to an integer value"<<throw_err{line_number, throw_err::types::interpreter};
+	_stream<<"format[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
 	}
-
-	_ctx.value=yieldtime;
+	_stream<<"]";
 }
 
-void instruction_break::run(
-	run_context& _ctx
+void instruction_builder::format_out(
+	std::ostream& _stream
 ) const {
 
-	_ctx.signal=run_context::signals::sigbreak;
+	_stream<<"builder[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
 }
 
-void instruction_exit::run(
-	run_context& _ctx
+void instruction_builder_freeze::format_out(
+	std::ostream& _stream
 ) const {
 
-	_ctx.signal=run_context::signals::sigexit;
+	_stream<<"builder_freeze[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
 }
 
-void instruction_conditional_branch::run(
-	run_context& _ctx
+void instruction_builder_append::format_out(
+	std::ostream& _stream
 ) const {
 
-	for(const auto& branch : branches) {
-
-		//This is the else...
-		if(!branch.function) {
+	_stream<<"builder_append[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
 
-			_ctx.signal=run_context::signals::sigjump;
-			_ctx.value=branch.target_block_index;
-			return;
-		}
+void instruction_concatenate::format_out(
+	std::ostream& _stream
+) const {
 
-		//This is anything that can be evaluated...
-		auto val=branch.function->evaluate(_ctx);
-		if(val.type!=variable::types::boolean) {
+	_stream<<"concatenate[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
 
-			error_builder::get()<<"evaluation type mismatch, must be boolean values"<<throw_err{branch.line_number, throw_err::types::interpreter};
-		}
+void instruction_substract::format_out(
+	std::ostream& _stream
+) const {
 
-		//TODO: is this some kind of XOR?
-		if(!branch.negated && val.bool_val) {
+	_stream<<"substract[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
 
-			_ctx.signal=run_context::signals::sigjump;
-			_ctx.value=branch.target_block_index;
-			return;
-		}
-		else if(branch.negated && !val.bool_val) {
+void instruction_is_int::format_out(
+	std::ostream& _stream
+) const {
 
-			_ctx.signal=run_context::signals::sigjump;
-			_ctx.value=branch.target_block_index;
-			return;
-		}
+	_stream<<"is_int[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
 	}
+	_stream<<"]";
 }
 
-void instruction_loop::run(
-	run_context& _ctx
+void instruction_is_bool::format_out(
+	std::ostream& _stream
 ) const {
 
-	_ctx.signal=run_context::signals::sigjump;
-	_ctx.value=target_block_index;
+	_stream<<"is_bool[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
 }
 
-////////////////////////////////////////////////////////////////////////////////
-//Format out methods...
-
-void instruction_out::format_out(
+void instruction_is_double::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"out[";
+	_stream<<"is_double[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_fail::format_out(
+void instruction_is_string::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"fail[";
+	_stream<<"is_string[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_host_set::format_out(
+void instruction_host_has::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"host_set[";
+	_stream<<
+"host_has[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_host_add::format_out(
+void instruction_array_set::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"host_add[";
+	_stream<<"array_set[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_host_delete::format_out(
+void instruction_array_push::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"host_delete[";
+	_stream<<"array_push[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_host_do::format_out(
+void instruction_is_array::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"host_do[";
+	_stream<<"is_array[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_is_equal::format_out(
+void instruction_array::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"is_equal[";
+	_stream<<"array[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_generate_value::format_out(
+void instruction_array_size::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"generate_value[";
+	_stream<<"array_size[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_copy_from_return_register::format_out(
+void instruction_array_get::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"copy_from_return_register[]";
+	_stream<<"array_get[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
 }
 
-void instruction_is_greater_than::format_out(
+void instruction_array_pop::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"is_greater_than[";
+	_stream<<"array_pop[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_is_lesser_than::format_out(
+void instruction_array_slice::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"is_lesser_than[";
+	_stream<<"array_slice[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_add::format_out(
+void instruction_map_set::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"add[";
+	_stream<<"map_set[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_concatenate::format_out(
+void instruction_map_erase::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"concatenate[";
+	_stream<<"map_erase[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_substract::format_out(
+void instruction_is_map::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"substract[";
+	_stream<<"is_map[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_is_int::format_out(
+void instruction_map::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"is_int[";
+	_stream<<"map[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_is_bool::format_out(
+void instruction_map_size::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"is_bool[";
+	_stream<<"map_size[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_is_double::format_out(
+void instruction_map_get::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"is_double[";
+	_stream<<"map_get[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_is_string::format_out(
+void instruction_map_has::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<"is_string[";
+	_stream<<"map_has[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
-void instruction_host_has::format_out(
+void instruction_struct_set::format_out(
 	std::ostream& _stream
 ) const {
 
-	_stream<<
-"host_has[";
+	_stream<<"struct_set["<<arguments[0]<<","<<type->name<<"."<<type->fields[field].name<<","<<arguments[1]<<",]";
+}
+
+void instruction_struct_new::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"new "<<type->name<<"[";
 	for(const auto& var : arguments) {
 		_stream<<var<<",";
 	}
 	_stream<<"]";
 }
 
+void instruction_struct_get::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"struct_get["<<arguments[0]<<","<<type->name<<"."<<type->fields[field].name<<",]";
+}
+
 void instruction_host_get::format_out(
 	std::ostream& _stream
 ) const {
@@ -883,6 +2608,17 @@ void instruction_host_get::format_out(
 	_stream<<"]";
 }
 
+void instruction_host_query_async::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"host_query_async[";
+	for(const auto& var : arguments) {
+		_stream<<var<<",";
+	}
+	_stream<<"]";
+}
+
 void instruction_host_query::format_out(
 	std::ostream& _stream
 ) const {
@@ -912,6 +2648,13 @@ void instruction_yield::format_out(
 	_stream<<"yield";
 }
 
+void instruction_yield_until::format_out(
+	std::ostream& _stream
+) const {
+
+	_stream<<"yield until "<<event;
+}
+
 void instruction_break::format_out(
 	std::ostream& _stream
 ) const {
@@ -967,6 +2710,21 @@ void instruction_loop::format_out(
 	_stream<<"jump to and loop "<<target_block_index<<std::endl;
 }
 
+int struct_type::find(
+	std::string_view _name
+) const {
+
+	for(std::size_t i=0; i<fields.size(); i++) {
+
+		if(fields[i].name==_name) {
+
+			return i;
+		}
+	}
+
+	return -1;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // ostream overloads.
 
@@ -1013,6 +2771,10 @@ std::ostream& ascript::operator<<(
 		case parameter::types::decimal: _stream<<"decimal"; break;
 		case parameter::types::boolean: _stream<<"boolean"; break;
 		case parameter::types::string: _stream<<"string"; break;
+		case parameter::types::array: _stream<<"array"; break;
+		case parameter::types::structure: _stream<<"struct"; break;
+		case parameter::types::map: _stream<<"map"; break;
+		case parameter::types::builder: _stream<<"builder"; break;
 		case parameter::types::any: _stream<<"any"; break;
 	}
 
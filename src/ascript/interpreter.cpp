@@ -1,13 +1,15 @@
 #include "ascript/interpreter.h"
 #include "ascript/error.h"
 
+#include <algorithm>
+
 //TODO:
 #include <iostream>
 
 using namespace ascript;
 
 interpreter::interpreter()
-	:yield_release_time{std::chrono::system_clock::time_point::min()},
+	:yield_release_time{time_source::time_point::min()},
 	yield_pause_time{yield_release_time}
 {
 
@@ -20,7 +22,7 @@ return_value interpreter::run(
 	const std::vector<variable>& _arguments
 ) {
 
-	return run(_host, _out_facility, *functions.at(_funcname), _arguments);
+	return run(_host, _out_facility, _funcname, _arguments, instruction_budget::unlimited());
 }
 
 return_value interpreter::run(
@@ -29,29 +31,85 @@ return_value interpreter::run(
 	const function& _function, 
 	const std::vector<variable>& _arguments
 ) {
-	current_host=&_host;
-	out_facility=&_out_facility;
 
-	auto symbol_table=prepare_symbol_table(_function, _arguments, 0);
+	return run(_host, _out_facility, _function, _arguments, instruction_budget::unlimited());
+}
 
-	//Start the first stack...
-	stacks.push_back(
-		{&_function, 0, 0, {current_host, out_facility}}
-	);
+return_value interpreter::run(
+	host& _host,
+	out_interface& _out_facility,
+	const std::string& _funcname, 
+	const std::vector<variable>& _arguments,
+	instruction_budget _budget
+) {
 
-	current_stack=&stacks.back();
-	current_stack->context.symbol_table=symbol_table;
+	const function * fn=find_function(_funcname);
+	if(nullptr==fn) {
+
+		throw std::runtime_error(std::string{"function "}
+			+_funcname
+			+" does not exist"
+		);
+	}
+
+	return run(_host, _out_facility, *fn, _arguments, _budget);
+}
+
+return_value interpreter::run(
+	host& _host,
+	out_interface& _out_facility,
+	const function& _function, 
+	const std::vector<variable>& _arguments,
+	instruction_budget _budget
+) {
+	context.host_ptr=&_host;
+	context.out_facility=&_out_facility;
+	context.return_register.reset();
+	context.pending_query.reset();
+
+	auto symbol_table=get_spare_table();
+	prepare_symbol_table(symbol_table, _function, _arguments, 0);
+
+	//Start the first stack...
+	push_stack(&_function, 0, symbol_table);
 
 	//Reset all signals and enter the main loop.
 	break_signal=false;
 	yield_signal=false;
 	failed_signal=false;
+	preempted_signal=false;
+	instructions_left=_budget.instructions;
+	deadline=std::chrono::steady_clock::time_point::max();
 
 	return interpret();
 }
 
 return_value interpreter::resume() {
 
+	return resume(instruction_budget::unlimited());
+}
+
+return_value interpreter::resume(
+	instruction_budget _budget
+) {
+
+	return continue_execution(_budget, std::chrono::steady_clock::time_point::max());
+}
+
+return_value interpreter::resume_until(
+	std::chrono::steady_clock::time_point _deadline
+) {
+
+	auto result=continue_execution(instruction_budget::unlimited(), _deadline);
+	stats.add(_deadline, std::chrono::steady_clock::now(), result.is_preempted());
+	return result;
+}
+
+return_value interpreter::continue_execution(
+	instruction_budget _budget,
+	std::chrono::steady_clock::time_point _deadline
+) {
+
 	if(!yield_signal) {
 
 		throw std::runtime_error("called resume on non yielding process");
@@ -60,14 +118,42 @@ return_value interpreter::resume() {
 	//If paused, will return "yield", even if the internal time elapsed. That
 	//is, if yielding for one second and a call to pause happens after two 
 	//seconds it will count as yielded until unpaused.
-	if(yield_pause_time!=std::chrono::system_clock::time_point::min()) {
+	if(yield_pause_time!=time_source::time_point::min()) {
+
+		return {return_value::types::yield};
+	}
+
+	//Waiting for an event that has not been signaled.
+	if(!awaited_event.empty()) {
 
 		return {return_value::types::yield};
 	}
 
-	if(yield_release_time!=std::chrono::system_clock::time_point::min()) {
+	//Waiting for a host query, whose answer goes to the return register 
+	//for the instruction that follows.
+	if(context.pending_query) {
+
+		if(!context.pending_query->is_done()) {
+
+			return {return_value::types::yield};
+		}
+
+		const auto query=std::move(context.pending_query);
+		if(query->is_failed()) {
+
+			yield_signal=false;
+			failed_signal=true;
+			const auto& block=current_stack->current_function->blocks[current_stack->block_index];
+			error_builder::get()<<"host query failed: "<<query->get_error()
+				<<throw_err{block.instructions[current_stack->instruction_index-1]->line_number, throw_err::types::host};
+		}
+
+		context.return_register=query->get_value();
+	}
+
+	if(yield_release_time!=time_source::time_point::min()) {
 
-		auto now=std::chrono::system_clock::now();
+		auto now=clock->now();
 		auto count=std::chrono::duration_cast<std::chrono::milliseconds>(yield_release_time-now).count();
 		if(count > 0) {
 
@@ -75,11 +161,27 @@ return_value interpreter::resume() {
 		}
 	}
 
-	yield_release_time=std::chrono::system_clock::time_point::min();
+	yield_release_time=time_source::time_point::min();
 	yield_signal=false;
+	preempted_signal=false;
+	instructions_left=_budget.instructions;
+	deadline=_deadline;
 	return interpret();
 }
 
+return_value interpreter::preempt() {
+
+	yield_signal=true;
+	preempted_signal=true;
+	return {return_value::yields::preemption};
+}
+
+bool interpreter::is_past_deadline() const {
+
+	return deadline!=std::chrono::steady_clock::time_point::max()
+		&& std::chrono::steady_clock::now() >= deadline;
+}
+
 return_value interpreter::interpret() {
 
 	try {
@@ -119,13 +221,21 @@ return_value interpreter::interpret() {
 			//Popping and pushing the stack will just reset everything we need.
 			if(current_block.type==block::types::loop) {
 
-				const auto stack_copy=*current_stack;
+				const auto loop_function=current_stack->current_function;
+				const auto loop_block_index=current_stack->block_index;
 
 				pop_stack(false, current_block.instructions.back()->line_number);
 				push_stack(
-					stack_copy.current_function,
-					stack_copy.block_index
+					loop_function,
+					loop_block_index
 				);
+
+				//Loop back-edges are one of the places where deadlines are
+				//checked.
+				if(is_past_deadline()) {
+
+					return preempt();
+				}
 			}
 			else {
 
@@ -136,23 +246,32 @@ return_value interpreter::interpret() {
 			continue; //Continue so we exit if the stacks are empty.
 		}
 
+		//Out of budget: stop just like a yield statement would, so the 
+		//instruction is run when resumed.
+		if(!instructions_left) {
+
+			return preempt();
+		}
+
+		--instructions_left;
+
 		const auto& instruction=current_block.instructions[current_stack->instruction_index];
-		current_stack->context.reset(); //Reset any data derived from the previous instruction.
+		context.reset(); //Reset the signal derived from the previous instruction.
 
 //std::cout<<*instruction<<std::endl;
 
 		++current_stack->instruction_index;
 
-		instruction->run(current_stack->context);
+		instruction->run(context);
 
 		//!Evaluate signals.
-		switch(current_stack->context.signal) {
+		switch(context.signal) {
 
 			case run_context::signals::none: break;
 			case run_context::signals::sigfail: 
 
 				error_builder::get()<<"fail signal raised: "
-					<<current_stack->context.value.str_val
+					<<context.value.get_string()
 					<<throw_err{instruction->line_number, throw_err::types::user};
 			break;
 
@@ -164,7 +283,9 @@ return_value interpreter::interpret() {
 			case run_context::signals::sigreturnval:
 			case run_context::signals::sigreturn:{
 
-				auto exiting_stack=*current_stack;
+				//The return register was already set (or cleared) by the 
+				//instruction and is not touched when popping stacks.
+				const bool has_value=context.signal==run_context::signals::sigreturnval;
 
 				//Pop stacks until we pop the last of a function. Remember that
 				//a function might have more than one stack (one per block).
@@ -177,21 +298,17 @@ return_value interpreter::interpret() {
 					//Did we unwind the full function?
 					if(0==exiting_fn_block) {
 
-						//Are we returning to another function? If so, copy
-						//the returned value to the current stack...
+						//Are we returning to another function? The returned
+						//value stays in the register for the caller to read.
 						if(stacks.size()) {
-							if(exiting_stack.context.signal==run_context::signals::sigreturnval) {
-
-								current_stack->context.return_register=exiting_stack.context.return_register;
-							}
 
 							break;
 						}
 						//Returning from the main function of this interpreter.
 						else {
 
-							return (exiting_stack.context.signal==run_context::signals::sigreturnval)
-								? return_value{exiting_stack.context.return_register.value()}
+							return has_value
+								? return_value{context.return_register.value()}
 								: return_value{return_value::types::nothing};
 						}
 					}
@@ -200,19 +317,24 @@ return_value interpreter::interpret() {
 			break;
 			case run_context::signals::sigexit:
 
-				stacks.clear();
+				clear_stacks();
 				return {return_value::types::nothing};
 			break;
 			case run_context::signals::sigyield:
 
 				yield_signal=true;
 
+				//A string value names the event the script waits for.
+				if(context.value.type==variable::types::string) {
+
+					awaited_event=context.value.get_string();
+				}
 				//If there was a time expression in the yield, calculate the
 				//moment in which this interpreter becomes available again.
-				if(current_stack->context.value.int_val) {
+				else if(context.value.get_int()) {
 
-					auto now=std::chrono::system_clock::now();
-					yield_release_time=now+std::chrono::milliseconds(current_stack->context.value.int_val);
+					auto now=clock->now();
+					yield_release_time=now+std::chrono::milliseconds(context.value.get_int());
 				}
 
 				return {return_value::types::yield};
@@ -221,24 +343,38 @@ return_value interpreter::interpret() {
 			case run_context::signals::sigcall:{
 
 				//Check if the function exists...
-				if(!functions.count(current_stack->context.value.str_val)) {
+				const function * fn=find_function(context.value.get_string());
+				if(nullptr==fn) {
 
 					error_builder::get()<<"undefined function "
-						<<current_stack->context.value.str_val
+						<<context.value.get_string()
 						<<throw_err{instruction->line_number, throw_err::types::interpreter};
 				}
 
-				auto symbol_table=prepare_symbol_table(
-					*functions.at(current_stack->context.value.str_val), 
-					current_stack->context.arguments, 
+				auto symbol_table=get_spare_table();
+				prepare_symbol_table(
+					symbol_table,
+					*fn, 
+					context.arguments, 
 					instruction->line_number
 				);
 
+				//A function that returns nothing must not leave a stale
+				//value for the caller.
+				context.return_register.reset();
+
 				push_stack(
-					functions.at(current_stack->context.value.str_val),
+					fn,
 					0,
 					symbol_table
 				);
+
+				//Function calls are the other place where deadlines are 
+				//checked.
+				if(is_past_deadline()) {
+
+					return preempt();
+				}
 			}
 			break;
 
@@ -248,7 +384,7 @@ return_value interpreter::interpret() {
 
 				push_stack(
 					current_stack->current_function,
-					current_stack->context.value.int_val
+					context.value.get_int()
 				);
 			break;
 		}
@@ -270,28 +406,28 @@ void interpreter::push_stack(
 ) {
 
 	//Copy the current symbol table to make it available on the next stack.
-	auto exiting_table=current_stack->context.symbol_table;
+	//Copying over a recycled table reuses its memory.
+	auto exiting_table=get_spare_table();
+	exiting_table=current_stack->symbol_table;
 
 	stacks.push_back(
-		{_function, _stack_index, 0, {current_host, out_facility}}
+		{_function, _stack_index, 0, std::move(exiting_table)}
 	);
 
-	current_stack=&stacks.back();
-	current_stack->context.symbol_table=exiting_table;
+	refresh_current_stack();
 }
 
 void interpreter::push_stack(
 	const function * _function, 
 	int _stack_index, 
-	std::map<std::string, variable>& _symbol_table
+	ascript::symbol_table& _symbol_table
 ) {
 
 	stacks.push_back(
-		{_function, _stack_index, 0, {current_host, out_facility}}
+		{_function, _stack_index, 0, std::move(_symbol_table)}
 	);
 
-	current_stack=&stacks.back();
-	current_stack->context.symbol_table=std::move(_symbol_table);
+	refresh_current_stack();
 }
 
 void interpreter::pop_stack(
@@ -301,32 +437,100 @@ void interpreter::pop_stack(
 
 	//Get the exiting table so we can overwrite the symbols on the parent 
 	//table if they existed on the one we just ran.
-	auto exiting_table=current_stack->context.symbol_table;
+	auto exiting_table=std::move(current_stack->symbol_table);
+	const auto exiting_function=current_stack->current_function;
 
 	stacks.pop_back();
 
 	if(!stacks.size()) {
 
+		current_stack=nullptr;
+		context.symbol_table=nullptr;
+		spare_tables.push_back(std::move(exiting_table));
+
 		if(into_break) {
 
 			error_builder::get()
 				<<"unexpected break outside loop in "
-				<<current_stack->current_function->name
+				<<exiting_function->name
 				<<throw_err{_line_number, throw_err::types::interpreter};
 		}
 
-		current_stack=nullptr;
 		return;
 	}
 
-	current_stack=&stacks.back();
-	for(auto& symbol : current_stack->context.symbol_table) {
-	
-		if(exiting_table.count(symbol.first)) {
+	refresh_current_stack();
+	current_stack->symbol_table.update_from(exiting_table);
+	spare_tables.push_back(std::move(exiting_table));
+}
 
-			symbol.second=exiting_table.at(symbol.first);
-		}
+void interpreter::clear_stacks() {
+
+	for(auto& s : stacks) {
+
+		spare_tables.push_back(std::move(s.symbol_table));
+	}
+
+	stacks.clear();
+	current_stack=nullptr;
+	context.symbol_table=nullptr;
+}
+
+ascript::symbol_table interpreter::get_spare_table() {
+
+	if(spare_tables.empty()) {
+
+		return {};
+	}
+
+	auto result=std::move(spare_tables.back());
+	spare_tables.pop_back();
+	result.clear();
+	return result;
+}
+
+void interpreter::reset() {
+
+	clear_stacks();
+	functions.clear();
+	shared_functions.reset();
+	context.host_ptr=nullptr;
+	context.out_facility=nullptr;
+	context.mailbox_ptr=nullptr;
+	context.overflow=overflow_policy::wrap;
+	context.reset();
+	context.return_register.reset();
+	context.pending_query.reset();
+	context.arguments.clear();
+	break_signal=false;
+	yield_signal=false;
+	failed_signal=false;
+	preempted_signal=false;
+	instructions_left=0;
+	deadline=std::chrono::steady_clock::time_point::max();
+	stats=deadline_stats{};
+	yield_release_time=time_source::time_point::min();
+	yield_pause_time=time_source::time_point::min();
+	awaited_event.clear();
+}
+
+bool interpreter::notify(
+	const std::string& _event
+) {
+
+	if(!is_event_yield() || awaited_event!=_event) {
+
+		return false;
 	}
+
+	awaited_event.clear();
+	return true;
+}
+
+void interpreter::refresh_current_stack() {
+
+	current_stack=&stacks.back();
+	context.symbol_table=&current_stack->symbol_table;
 }
 
 void interpreter::remove_function(
@@ -337,7 +541,7 @@ void interpreter::remove_function(
 
 		throw std::runtime_error(std::string{"function "}
 			+_funcname
-			+"does not exist"
+			+(has_function(_funcname) ? " belongs to a shared table" : " does not exist")
 		);
 	}
 
@@ -348,7 +552,7 @@ void interpreter::add_function(
 	const function& _func
 ) {
 
-	if(functions.count(_func.name)) {
+	if(has_function(_func.name)) {
 
 		throw std::runtime_error(std::string{"function "}
 			+_func.name
@@ -359,14 +563,26 @@ void interpreter::add_function(
 	functions.insert(std::make_pair(_func.name, &_func));
 }
 
-std::map<std::string, variable> interpreter::prepare_symbol_table(
+const function * interpreter::find_function(
+	std::string_view _funcname
+) const {
+
+	const auto it=functions.find(_funcname);
+	if(it!=std::end(functions)) {
+
+		return it->second;
+	}
+
+	return shared_functions ? shared_functions->find(_funcname) : nullptr;
+}
+
+void interpreter::prepare_symbol_table(
+	ascript::symbol_table& _symbol_table,
 	const function& _function, 
 	const std::vector<variable>& _arguments,
 	int _line_number
 ) {
 
-	std::map<std::string, variable> symbol_table;
-
 	if(_arguments.size() != _function.parameters.size()) {
 
 		error_builder::get()
@@ -407,6 +623,26 @@ std::map<std::string, variable> interpreter::prepare_symbol_table(
 					failed=true;
 				}
 			break;
+			case parameter::types::array:
+				if(arg.type!=variable::types::array) {
+					failed=true;
+				}
+			break;
+			case parameter::types::structure:
+				if(arg.type!=variable::types::structure) {
+					failed=true;
+				}
+			break;
+			case parameter::types::map:
+				if(arg.type!=variable::types::map) {
+					failed=true;
+				}
+			break;
+			case parameter::types::builder:
+				if(arg.type!=variable::types::builder) {
+					failed=true;
+				}
+			break;
 			case parameter::types::any: break;
 		}
 
@@ -418,10 +654,8 @@ std::map<std::string, variable> interpreter::prepare_symbol_table(
 				<<throw_err{0, throw_err::types::interpreter};
 		}
 
-		symbol_table.insert(std::make_pair(param.name, _arguments[index++]));
+		_symbol_table.insert(param.name, _arguments[index++]);
 	}
-
-	return symbol_table;
 }
 
 int interpreter::get_yield_ms_left() const {
@@ -433,12 +667,12 @@ int interpreter::get_yield_ms_left() const {
 	}
 
 	//Is it a timed yield?
-	if(false) {
+	if(!is_timed_yield()) {
 
 		return 0;
 	}
 
-	auto now=std::chrono::system_clock::now();
+	auto now=clock->now();
 	return std::chrono::duration_cast<std::chrono::milliseconds>(yield_release_time-now).count();
 }
 
@@ -456,7 +690,7 @@ void interpreter::pause() {
 			<<throw_err{0, throw_err::types::interpreter};
 	}
 
-	yield_pause_time=std::chrono::system_clock::now();
+	yield_pause_time=clock->now();
 }
 
 void interpreter::unpause() {
@@ -467,9 +701,35 @@ void interpreter::unpause() {
 			<<throw_err{0, throw_err::types::interpreter};
 	}
 
-	auto now=std::chrono::system_clock::now();
+	auto now=clock->now();
 	int ms_elapsed_since_pause=std::chrono::duration_cast<std::chrono::milliseconds>(now-yield_pause_time).count();
 
 	yield_release_time+=std::chrono::milliseconds(ms_elapsed_since_pause);
-	yield_pause_time=std::chrono::system_clock::time_point::min();
+	yield_pause_time=time_source::time_point::min();
+}
+
+void deadline_stats::add(
+	std::chrono::steady_clock::time_point _deadline,
+	std::chrono::steady_clock::time_point _returned,
+	bool _preempted
+) {
+
+	++runs;
+
+	if(_preempted) {
+
+		++preemptions;
+	}
+
+	if(_returned <= _deadline) {
+
+		return;
+	}
+
+	auto overshoot=std::chrono::duration_cast<std::chrono::nanoseconds>(_returned-_deadline);
+
+	++overshoots;
+	last_overshoot=overshoot;
+	max_overshoot=std::max(max_overshoot, overshoot);
+	total_overshoot+=overshoot;
 }
@@ -0,0 +1,178 @@
+#include "ascript/map.h"
+
+#include <stdexcept>
+#include <functional>
+#include <string_view>
+
+using namespace ascript;
+
+//Tables are kept at most three quarters full.
+static bool is_overloaded(
+	std::size_t _count,
+	std::size_t _capacity
+) {
+
+	return _count*4 > _capacity*3;
+}
+
+const variable * map::find(
+	const variable& _key
+) const {
+
+	if(empty()) {
+
+		return nullptr;
+	}
+
+	const auto index=probe(_key, hash(_key));
+	return hashes[index] ? &slots[index].value : nullptr;
+}
+
+void map::set(
+	const variable& _key,
+	const variable& _value
+) {
+
+	const auto key_hash=hash(_key);
+
+	if(variable::types::map==_value.type) {
+
+		throw std::runtime_error("maps cannot hold maps");
+	}
+
+	if(hashes.empty()) {
+
+		rehash(8);
+	}
+
+	auto index=probe(_key, key_hash);
+	if(hashes[index]) {
+
+		slots[index].value=_value;
+		return;
+	}
+
+	//Only new keys make the table grow, which moves the slot they go to.
+	if(is_overloaded(count+1, hashes.size())) {
+
+		rehash(hashes.size()*2);
+		index=probe(_key, key_hash);
+	}
+
+	hashes[index]=key_hash;
+	slots[index].key=_key;
+	slots[index].value=_value;
+	++count;
+}
+
+bool map::erase(
+	const variable& _key
+) {
+
+	if(empty()) {
+
+		return false;
+	}
+
+	auto index=probe(_key, hash(_key));
+	if(!hashes[index]) {
+
+		return false;
+	}
+
+	//Entries after the hole that could sit in it are moved back, so probes
+	//never need to skip removed entries.
+	const std::size_t mask=hashes.size()-1;
+	for(std::size_t next=(index+1) & mask; hashes[next]; next=(next+1) & mask) {
+
+		const std::size_t ideal=hashes[next] & mask;
+		if(((next-ideal) & mask) >= ((next-index) & mask)) {
+
+			hashes[index]=hashes[next];
+			slots[index]=std::move(slots[next]);
+			index=next;
+		}
+	}
+
+	hashes[index]=0;
+	slots[index]=slot{};
+	--count;
+	return true;
+}
+
+void map::reserve(
+	std::size_t _size
+) {
+
+	std::size_t capacity=hashes.empty() ? 8 : hashes.size();
+	while(is_overloaded(_size, capacity)) {
+
+		capacity*=2;
+	}
+
+	if(capacity > hashes.size()) {
+
+		rehash(capacity);
+	}
+}
+
+std::uint32_t map::hash(
+	const variable& _key
+) {
+
+	std::uint64_t result=0;
+	switch(_key.type) {
+
+		case variable::types::integer:
+			//Fibonacci hashing spreads consecutive ids over the table.
+			result=(std::uint64_t)_key.get_int() * 0x9e3779b97f4a7c15ull;
+			result>>=32;
+		break;
+		case variable::types::string:
+			result=std::hash<std::string_view>{}(_key.get_string());
+			result^=result >> 32;
+		break;
+		default:
+			throw std::runtime_error("map keys must be integers or strings");
+	}
+
+	//0 marks empty slots.
+	return (std::uint32_t)result | 0x80000000u;
+}
+
+std::size_t map::probe(
+	const variable& _key,
+	std::uint32_t _hash
+) const {
+
+	const std::size_t mask=hashes.size()-1;
+	for(std::size_t index=_hash & mask;; index=(index+1) & mask) {
+
+		if(!hashes[index] || (hashes[index]==_hash && slots[index].key==_key)) {
+
+			return index;
+		}
+	}
+}
+
+void map::rehash(
+	std::size_t _capacity
+) {
+
+	std::vector<std::uint32_t> old_hashes(_capacity, 0);
+	std::vector<slot> old_slots(_capacity);
+	old_hashes.swap(hashes);
+	old_slots.swap(slots);
+
+	for(std::size_t i=0; i<old_hashes.size(); i++) {
+
+		if(!old_hashes[i]) {
+
+			continue;
+		}
+
+		const auto index=probe(old_slots[i].key, old_hashes[i]);
+		hashes[index]=old_hashes[i];
+		slots[index]=std::move(old_slots[i]);
+	}
+}
@@ -0,0 +1,277 @@
+#include "ascript/parallel_environment.h"
+#include "ascript/tokenizer.h"
+#include "ascript/parser.h"
+#include "ascript/error.h"
+
+#include <algorithm>
+
+using namespace ascript;
+
+parallel_environment::parallel_environment(
+	host& _host,
+	out_interface& _out,
+	std::size_t _workers
+):
+	host_instance{_host},
+	outfacility{_out},
+	shared_functions{new function_table{{}}}
+{
+
+	if(0==_workers) {
+
+		_workers=std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for(std::size_t i=0; i<_workers; i++) {
+
+		queues.emplace_back(new worker_queue);
+	}
+
+	for(std::size_t i=0; i<_workers; i++) {
+
+		workers.emplace_back(&parallel_environment::work, this, i);
+	}
+}
+
+parallel_environment::~parallel_environment() {
+
+	{
+		std::lock_guard<std::mutex> lock(tick_mutex);
+		stopping=true;
+	}
+
+	tick_start.notify_all();
+	for(auto& worker : workers) {
+
+		worker.join();
+	}
+}
+
+void parallel_environment::load(
+	const std::string& _filename
+) {
+
+	tokenizer tk;
+	const auto tokens=tk.from_file(_filename);
+
+	parser p;
+	for(auto& s : p.parse(tokens)) {
+
+		load(s);
+	}
+}
+
+void parallel_environment::load(
+	function& _function
+) {
+
+	std::string funcname=_function.name;
+
+	if(functions.count(funcname)) {
+
+		error_builder::get()<<"a function named '"<<funcname<<"' is already loaded"<<throw_err{0, throw_err::types::user};
+	}
+
+	functions.emplace(std::make_pair(funcname, std::move(_function)));
+
+	//Interpreters already alive keep the table they started with.
+	std::vector<const function *> index;
+	index.reserve(functions.size());
+	for(const auto& pair : functions) {
+
+		index.push_back(&pair.second);
+	}
+
+	shared_functions=std::make_shared<const function_table>(index);
+}
+
+std::size_t parallel_environment::spawn(
+	const std::string& _function_name,
+	const std::vector<variable>& _arguments
+) {
+
+	const auto * fn=shared_functions->find(_function_name);
+	if(nullptr==fn) {
+
+		error_builder::get()<<"function '"<<_function_name<<"' is not loaded"<<throw_err{0, throw_err::types::user};
+	}
+
+	std::vector<variable> arguments;
+	arguments.reserve(_arguments.size());
+	for(const auto& argument : _arguments) {
+
+		arguments.push_back(argument.clone());
+	}
+
+	entries.emplace_back(new entry{++counter, *fn, std::move(arguments), outfacility, out_mutex});
+	entries.back()->interpreter.set_function_table(shared_functions);
+	return counter;
+}
+
+parallel_tick parallel_environment::run_all_ready() {
+
+	parallel_tick result;
+	if(entries.empty()) {
+
+		return result;
+	}
+
+	//Each worker starts with a contiguous share of the interpreters. The
+	//counter is set before any job can be taken.
+	pending=entries.size();
+	const std::size_t total=entries.size(),
+	                  worker_count=queues.size();
+
+	for(std::size_t i=0; i<worker_count; i++) {
+
+		std::lock_guard<std::mutex> lock(queues[i]->mutex);
+		for(std::size_t job=total*i/worker_count; job<total*(i+1)/worker_count; job++) {
+
+			queues[i]->jobs.push_back(job);
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(tick_mutex);
+		++tick;
+		tick_start.notify_all();
+		tick_end.wait(lock, [this]() {return 0==pending;});
+	}
+
+	//Collect and remove whatever did not yield.
+	result.runs=total;
+	for(auto& e : entries) {
+
+		if(e->error.size()) {
+
+			result.failed.push_back({e->id, e->error});
+		}
+		else if(!e->result->is_yield()) {
+
+			result.finished.push_back({e->id, *e->result});
+		}
+	}
+
+	entries.erase(
+		std::remove_if(
+			std::begin(entries),
+			std::end(entries),
+			[](const std::unique_ptr<entry>& _entry) {
+				return _entry->error.size() || !_entry->result->is_yield();
+			}
+		),
+		std::end(entries)
+	);
+
+	return result;
+}
+
+void parallel_environment::work(
+	std::size_t _index
+) {
+
+	std::size_t last_tick=0;
+	while(true) {
+
+		{
+			std::unique_lock<std::mutex> lock(tick_mutex);
+			tick_start.wait(lock, [this, last_tick]() {return stopping || tick!=last_tick;});
+			if(stopping) {
+
+				return;
+			}
+
+			last_tick=tick;
+		}
+
+		std::size_t job=0;
+		while(take_job(_index, job)) {
+
+			run_job(job);
+
+			//The last job wakes the owner. Taking the lock first ensures the
+			//owner is either waiting or has not checked the counter yet.
+			if(1==pending.fetch_sub(1)) {
+
+				std::lock_guard<std::mutex> lock(tick_mutex);
+				tick_end.notify_one();
+			}
+		}
+	}
+}
+
+bool parallel_environment::take_job(
+	std::size_t _index,
+	std::size_t& _job
+) {
+
+	//Own jobs are taken from the back...
+	{
+		auto& own=*queues[_index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if(own.jobs.size()) {
+
+			_job=own.jobs.back();
+			own.jobs.pop_back();
+			return true;
+		}
+	}
+
+	//...and stolen from the front of the others, so the thief and the owner
+	//rarely want the same end.
+	for(std::size_t i=1; i<queues.size(); i++) {
+
+		auto& victim=*queues[(_index+i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(victim.jobs.size()) {
+
+			_job=victim.jobs.front();
+			victim.jobs.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void parallel_environment::run_job(
+	std::size_t _job
+) {
+
+	auto& e=*entries[_job];
+
+	try {
+
+		if(nullptr!=e.fn) {
+
+			const auto * fn=e.fn;
+			e.fn=nullptr;
+			e.result=e.interpreter.run(host_instance, e.out, *fn, e.arguments);
+			e.arguments.clear();
+		}
+		else {
+
+			e.result=e.interpreter.resume();
+		}
+	}
+	catch(std::exception& ex) {
+
+		e.error=ex.what();
+		if(e.error.empty()) {
+
+			e.error="unknown error";
+		}
+	}
+}
+
+void parallel_environment::buffered_out::flush() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for(const auto& var : buffer) {
+
+		target.out(var);
+	}
+
+	target.flush();
+	buffer.clear();
+}
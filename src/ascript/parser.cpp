@@ -1,8 +1,11 @@
 #include "ascript/parser.h"
 #include "ascript/error.h"
+#include "ascript/run_context.h"
 
 #include <stdexcept>
 #include <algorithm>
+#include <iterator>
+#include <string_view>
 
 //TODO:
 #include <iostream>
@@ -22,7 +25,18 @@ void parser::root_mode() {
 
 	while(tokens.size()) {
 
-		expect(token::types::kw_beginfunction, "only beginfunction is allowed in root nodes");
+		auto declaration=extract();
+		if(declaration.type==token::types::kw_struct) {
+
+			struct_mode(declaration);
+			continue;
+		}
+
+		if(declaration.type!=token::types::kw_beginfunction) {
+
+			error_builder::get()<<"only beginfunction and struct are allowed in root nodes"<<throw_err{declaration.line_number, throw_err::types::parser};
+		}
+
 		auto functionname=expect(token::types::identifier, "beginfunction must be followed by an identifier");
 
 		std::vector<parameter> params;
@@ -39,6 +53,47 @@ void parser::root_mode() {
 	};
 }
 
+std::shared_ptr<const struct_type> parser::get_struct_type(
+	const std::string& _name
+) const {
+
+	auto it=struct_types.find(_name);
+	return it==std::end(struct_types) ? nullptr : it->second;
+}
+
+void parser::struct_mode(
+	const token& _token
+) {
+
+	//struct name [field as type, field as type];
+	auto name=expect(token::types::identifier, "struct must be followed by an identifier");
+	if(struct_types.count(name.str_val)) {
+
+		error_builder::get()<<"struct "<<name.str_val<<" is already declared"<<throw_err{name.line_number, throw_err::types::parser};
+	}
+
+	auto type=std::make_shared<struct_type>();
+	type->name=name.str_val;
+	type->fields=parameters_mode();
+	expect(token::types::semicolon, "struct declaration must end with a semicolon");
+
+	for(std::size_t i=0; i<type->fields.size(); i++) {
+
+		const auto& field=type->fields[i];
+		if(field.type==parameter::types::structure || field.type==parameter::types::map) {
+
+			error_builder::get()<<"struct fields cannot be structs or maps"<<throw_err{_token.line_number, throw_err::types::parser};
+		}
+
+		if(type->find(field.name)!=(int)i) {
+
+			error_builder::get()<<"repeated field "<<field.name<<" in struct "<<type->name<<throw_err{_token.line_number, throw_err::types::parser};
+		}
+	}
+
+	struct_types[type->name]=type;
+}
+
 void parser::function_mode(
 	const token& _function_tok,
 	const std::vector<parameter>& _parameters,
@@ -175,6 +230,30 @@ void parser::yield_mode(
 		);
 
 	}
+	else if(peek().type==token::types::kw_until) {
+
+		extract();
+		auto event_token=extract();
+
+		variable event{std::string{}};
+		if(event_token.type==token::types::val_string) {
+
+			event=build_variable(event_token);
+		}
+		else if(event_token.type==token::types::identifier) {
+
+			event={event_token.str_val, variable::types::symbol};
+		}
+		else {
+
+			error_builder::get()<<"string or symbol expected after yield until"<<throw_err{event_token.line_number, throw_err::types::parser};
+		}
+
+		expect(token::types::semicolon, "yield must be followed by a semicolon");
+		current_function.blocks[_block_index].instructions.emplace_back(
+			new instruction_yield_until(_token.line_number, event)
+		);
+	}
 	else {
 
 		expect(token::types::semicolon, "yield must be followed by a semicolon");
@@ -259,8 +338,7 @@ void parser::conditional_branch_mode(
 		}
 
 		auto function=extract();
-		auto fnptr=build_function(function);
-		fnptr->arguments=arguments_mode();
+		auto fnptr=built_in_function_mode(function);
 		expect(token::types::semicolon, "function for conditional branch declaration must end with semicolon");
 
 		//Add a new block for the branch...
@@ -398,6 +476,10 @@ std::vector<parameter> parser::parameters_mode(
 			case token::types::kw_string: ptype=parameter::types::string; break;
 			case token::types::kw_bool: ptype=parameter::types::boolean; break;
 			case token::types::kw_double: ptype=parameter::types::decimal; break;
+			case token::types::fn_array: ptype=parameter::types::array; break;
+			case token::types::kw_struct: ptype=parameter::types::structure; break;
+			case token::types::fn_map: ptype=parameter::types::map; break;
+			case token::types::fn_builder: ptype=parameter::types::builder; break;
 			case token::types::kw_anytype: ptype=parameter::types::any; break;
 			default:
 				error_builder::get()
@@ -453,14 +535,38 @@ void parser::variable_manipulation_mode(
 	}
 	else if(is_built_in_function(value)) {
 
-		fnptr=build_function(value);
+		fnptr=built_in_function_mode(value);
+		expect(token::types::semicolon, "variable declaration/assignment must be finished with a semicolon");
+	}
+	else if(value.type==token::types::kw_new) {
+
+		//new type [field value, field value...];
+		auto name=expect(token::types::identifier, "new must be followed by a struct name");
+		auto type=get_struct_type(name.str_val);
+		if(nullptr==type) {
+
+			error_builder::get()<<"unknown struct "<<name.str_val<<throw_err{name.line_number, throw_err::types::parser};
+		}
+
+		fnptr.reset(new instruction_struct_new(value.line_number, type));
 		fnptr->arguments=arguments_mode();
-		if(value.type==token::types::fn_host_get) {
+		if(fnptr->arguments.size()) {
 
-			check_argcount(1, fnptr->arguments, value);
+			check_argcount(type->fields.size(), fnptr->arguments, value);
 		}
 		expect(token::types::semicolon, "variable declaration/assignment must be finished with a semicolon");
 	}
+	else if(value.type==token::types::fn_host_query_async) {
+
+		//Works like a call: the query leaves its answer in the return 
+		//register, once it arrives.
+		auto arguments=arguments_mode();
+		expect(token::types::semicolon, "variable declaration/assignment must be finished with a semicolon");
+		current_function.blocks[_block_index].instructions.emplace_back(
+			new instruction_host_query_async(value.line_number, arguments)
+		);
+		fnptr.reset(new instruction_copy_from_return_register(value.line_number));
+	}
 	else if(value.type==token::types::identifier) {
 
 		//Returning is simulated with a call instruction, that would return
@@ -526,6 +632,39 @@ std::unique_ptr<instruction_function> parser::build_function(
 		case token::types::fn_is_string:
 			fnptr.reset(new instruction_is_string(_token_fn.line_number));
 			return fnptr;
+		case token::types::fn_is_array:
+			fnptr.reset(new instruction_is_array(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_array:
+			fnptr.reset(new instruction_array(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_array_size:
+			fnptr.reset(new instruction_array_size(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_array_get:
+			fnptr.reset(new instruction_array_get(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_array_pop:
+			fnptr.reset(new instruction_array_pop(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_array_slice:
+			fnptr.reset(new instruction_array_slice(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_is_map:
+			fnptr.reset(new instruction_is_map(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_map:
+			fnptr.reset(new instruction_map(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_map_size:
+			fnptr.reset(new instruction_map_size(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_map_get:
+			fnptr.reset(new instruction_map_get(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_map_has:
+			fnptr.reset(new instruction_map_has(_token_fn.line_number));
+			return fnptr;
 		case token::types::fn_host_has:
 			fnptr.reset(new instruction_host_has(_token_fn.line_number)); 
 			return fnptr;
@@ -544,6 +683,60 @@ std::unique_ptr<instruction_function> parser::build_function(
 		case token::types::fn_substract:
 			fnptr.reset(new instruction_substract(_token_fn.line_number)); 
 			return fnptr;
+		case token::types::fn_multiply:
+			fnptr.reset(new instruction_multiply(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_divide:
+			fnptr.reset(new instruction_divide(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_modulo:
+			fnptr.reset(new instruction_modulo(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_min:
+			fnptr.reset(new instruction_min(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_max:
+			fnptr.reset(new instruction_max(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_abs:
+			fnptr.reset(new instruction_abs(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_clamp:
+			fnptr.reset(new instruction_clamp(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_string_length:
+			fnptr.reset(new instruction_string_length(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_substring:
+			fnptr.reset(new instruction_substring(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_string_find:
+			fnptr.reset(new instruction_string_find(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_starts_with:
+			fnptr.reset(new instruction_starts_with(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_string_compare:
+			fnptr.reset(new instruction_string_compare(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_to_int:
+			fnptr.reset(new instruction_to_int(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_to_double:
+			fnptr.reset(new instruction_to_double(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_to_string:
+			fnptr.reset(new instruction_to_string(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_format:
+			fnptr.reset(new instruction_format(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_builder:
+			fnptr.reset(new instruction_builder(_token_fn.line_number));
+			return fnptr;
+		case token::types::fn_builder_freeze:
+			fnptr.reset(new instruction_builder_freeze(_token_fn.line_number));
+			return fnptr;
 		case token::types::identifier:
 			fnptr.reset(new instruction_copy_from_return_register(_token_fn.line_number)); 
 			return fnptr;
@@ -562,6 +755,178 @@ std::unique_ptr<instruction_function> parser::build_function(
 	return fnptr;
 }
 
+std::unique_ptr<instruction_function> parser::built_in_function_mode(
+	const token& _token_fn
+) {
+
+	if(_token_fn.type==token::types::fn_struct_get) {
+
+		auto arguments=arguments_mode();
+		check_argcount(2, arguments, _token_fn);
+
+		auto field=resolve_field(arguments[1], _token_fn);
+		std::unique_ptr<instruction_function> fnptr{new instruction_struct_get(_token_fn.line_number, field.first, field.second)};
+		fnptr->arguments.push_back(arguments[0]);
+		return fnptr;
+	}
+
+	auto fnptr=build_function(_token_fn);
+	fnptr->arguments=arguments_mode();
+
+	switch(_token_fn.type) {
+		case token::types::fn_add:
+		case token::types::fn_substract:
+		case token::types::fn_multiply:
+		case token::types::fn_divide:
+		case token::types::fn_modulo:
+		case token::types::fn_min:
+		case token::types::fn_max:
+			if(fnptr->arguments.empty()) {
+
+				error_builder::get()<<type_to_str(_token_fn.type)<<" expects at least a value"<<throw_err{_token_fn.line_number, throw_err::types::parser};
+			}
+		break;
+		case token::types::fn_abs:
+			check_argcount(1, fnptr->arguments, _token_fn);
+		break;
+		case token::types::fn_clamp:
+			check_argcount(3, fnptr->arguments, _token_fn);
+		break;
+		case token::types::fn_string_length:
+		case token::types::fn_to_string:
+		case token::types::fn_builder_freeze:
+			check_argcount(1, fnptr->arguments, _token_fn);
+		break;
+		case token::types::fn_format:
+			if(fnptr->arguments.empty()) {
+
+				error_builder::get()<<"format expects a format string and its values"<<throw_err{_token_fn.line_number, throw_err::types::parser};
+			}
+		break;
+		case token::types::fn_starts_with:
+		case token::types::fn_string_compare:
+			check_argcount(2, fnptr->arguments, _token_fn);
+		break;
+		case token::types::fn_substring:
+			if(fnptr->arguments.size()!=2 && fnptr->arguments.size()!=3) {
+
+				error_builder::get()<<"substring expects a string, a beginning and an optional end"<<throw_err{_token_fn.line_number, throw_err::types::parser};
+			}
+		break;
+		case token::types::fn_string_find:
+			if(fnptr->arguments.size()!=2 && fnptr->arguments.size()!=3) {
+
+				error_builder::get()<<"string_find expects a string, the string to find and an optional index to start from"<<throw_err{_token_fn.line_number, throw_err::types::parser};
+			}
+		break;
+		case token::types::fn_to_int:
+		case token::types::fn_to_double:
+			if(fnptr->arguments.size()!=1 && fnptr->arguments.size()!=2) {
+
+				error_builder::get()<<type_to_str(_token_fn.type)<<" expects a value and an optional default value"<<throw_err{_token_fn.line_number, throw_err::types::parser};
+			}
+		break;
+		case token::types::fn_host_get:
+		case token::types::fn_array_size:
+		case token::types::fn_array_pop:
+			check_argcount(1, fnptr->arguments, _token_fn);
+		break;
+		case token::types::fn_array_get:
+			check_argcount(2, fnptr->arguments, _token_fn);
+		break;
+		case token::types::fn_array_slice:
+			check_argcount(3, fnptr->arguments, _token_fn);
+		break;
+		case token::types::fn_map_size:
+			check_argcount(1, fnptr->arguments, _token_fn);
+		break;
+		case token::types::fn_map:
+			if(fnptr->arguments.size() % 2) {
+
+				error_builder::get()<<"map expects pairs of keys and values"<<throw_err{_token_fn.line_number, throw_err::types::parser};
+			}
+		break;
+		case token::types::fn_map_get:
+			if(fnptr->arguments.size()!=2 && fnptr->arguments.size()!=3) {
+
+				error_builder::get()<<"map_get expects a map, a key and an optional default value"<<throw_err{_token_fn.line_number, throw_err::types::parser};
+			}
+		break;
+		case token::types::fn_map_has:
+			if(fnptr->arguments.size() < 2) {
+
+				error_builder::get()<<"map_has expects a map and at least a key"<<throw_err{_token_fn.line_number, throw_err::types::parser};
+			}
+		break;
+		default: break;
+	}
+
+	return is_foldable(_token_fn) ? fold(std::move(fnptr)) : std::move(fnptr);
+}
+
+std::unique_ptr<instruction_function> parser::fold(
+	std::unique_ptr<instruction_function> _fn
+) const {
+
+	const bool literals=std::none_of(
+		std::begin(_fn->arguments),
+		std::end(_fn->arguments),
+		[](const variable& _arg) {return variable::types::symbol==_arg.type;}
+	);
+
+	if(!literals) {
+
+		return _fn;
+	}
+
+	//Overflows are checked so the folded value is the same under any policy.
+	//Anything that fails is left to fail when the script runs.
+	symbol_table table;
+	run_context context{nullptr, nullptr};
+	context.symbol_table=&table;
+	context.overflow=overflow_policy::check;
+
+	try {
+
+		std::unique_ptr<instruction_function> result{new instruction_generate_value(_fn->line_number)};
+		result->arguments.push_back(_fn->evaluate(context));
+		return result;
+	}
+	catch(std::exception&) {
+
+		return _fn;
+	}
+}
+
+std::pair<std::shared_ptr<const struct_type>, std::size_t> parser::resolve_field(
+	const variable& _field,
+	const token& _token
+) const {
+
+	//The tokenizer leaves type.field as an identifier, which arguments turn
+	//into a symbol.
+	const auto name=_field.get_string();
+	const auto dot=name.find('.');
+	if(_field.type!=variable::types::symbol || std::string_view::npos==dot) {
+
+		error_builder::get()<<"expected a field in the form type.field"<<throw_err{_token.line_number, throw_err::types::parser};
+	}
+
+	auto type=get_struct_type(std::string{name.substr(0, dot)});
+	if(nullptr==type) {
+
+		error_builder::get()<<"unknown struct "<<name.substr(0, dot)<<throw_err{_token.line_number, throw_err::types::parser};
+	}
+
+	const int index=type->find(name.substr(dot+1));
+	if(-1==index) {
+
+		error_builder::get()<<"struct "<<type->name<<" has no field "<<name.substr(dot+1)<<throw_err{_token.line_number, throw_err::types::parser};
+	}
+
+	return {type, index};
+}
+
 void parser::add_procedure(
 	const token& _token, 
 	std::vector<variable>& _arguments,
@@ -591,6 +956,52 @@ void parser::add_procedure(
 		case token::types::pr_host_do:
 			prptr=new instruction_host_do(_token.line_number);
 		break;
+		case token::types::pr_array_set:
+			check_argcount(3, _arguments, _token);
+			prptr=new instruction_array_set(_token.line_number);
+		break;
+		case token::types::pr_array_push:
+			if(_arguments.size() < 2) {
+
+				error_builder::get()<<"array_push expects an array and at least a value"<<throw_err{_token.line_number, throw_err::types::parser};
+			}
+			prptr=new instruction_array_push(_token.line_number);
+		break;
+		case token::types::pr_map_set:
+			check_argcount(3, _arguments, _token);
+			prptr=new instruction_map_set(_token.line_number);
+		break;
+		case token::types::pr_map_erase:
+			if(_arguments.size() < 2) {
+
+				error_builder::get()<<"map_erase expects a map and at least a key"<<throw_err{_token.line_number, throw_err::types::parser};
+			}
+			prptr=new instruction_map_erase(_token.line_number);
+		break;
+		case token::types::pr_builder_append:
+			if(_arguments.size() < 2) {
+
+				error_builder::get()<<"builder_append expects a builder and at least a value"<<throw_err{_token.line_number, throw_err::types::parser};
+			}
+			prptr=new instruction_builder_append(_token.line_number);
+		break;
+		case token::types::pr_struct_set: {
+
+			check_argcount(3, _arguments, _token);
+			auto field=resolve_field(_arguments[1], _token);
+			prptr=new instruction_struct_set(_token.line_number, field.first, field.second);
+
+			//The field is resolved, only the struct and the value are left.
+			_arguments.erase(std::next(std::begin(_arguments)));
+		}
+		break;
+		case token::types::pr_post:
+			if(_arguments.size() < 2) {
+
+				error_builder::get()<<"post expects at least a key and a function name"<<throw_err{_token.line_number, throw_err::types::parser};
+			}
+			prptr=new instruction_post(_token.line_number);
+		break;
 		default:
 
 			error_builder::get()<<"unknown procedure type '"<<type_to_str(_token.type)<<"' "<<throw_err{_token.line_number, throw_err::types::parser};
@@ -759,6 +1170,67 @@ bool parser::is_built_in_function(
 		case token::types::fn_add:
 		case token::types::fn_substract:
 		case token::types::fn_concatenate:
+		case token::types::fn_multiply:
+		case token::types::fn_divide:
+		case token::types::fn_modulo:
+		case token::types::fn_min:
+		case token::types::fn_max:
+		case token::types::fn_abs:
+		case token::types::fn_clamp:
+		case token::types::fn_string_length:
+		case token::types::fn_substring:
+		case token::types::fn_string_find:
+		case token::types::fn_starts_with:
+		case token::types::fn_string_compare:
+		case token::types::fn_to_int:
+		case token::types::fn_to_double:
+		case token::types::fn_to_string:
+		case token::types::fn_format:
+		case token::types::fn_builder:
+		case token::types::fn_builder_freeze:
+		case token::types::fn_is_array:
+		case token::types::fn_array:
+		case token::types::fn_array_size:
+		case token::types::fn_array_get:
+		case token::types::fn_array_pop:
+		case token::types::fn_array_slice:
+		case token::types::fn_struct_get:
+		case token::types::fn_is_map:
+		case token::types::fn_map:
+		case token::types::fn_map_size:
+		case token::types::fn_map_get:
+		case token::types::fn_map_has:
+			return true;
+		default:
+			return false;
+	}
+
+	return false;
+}
+
+bool parser::is_foldable(
+	const token& _token
+) const {
+
+	switch(_token.type) {
+		case token::types::fn_add:
+		case token::types::fn_substract:
+		case token::types::fn_multiply:
+		case token::types::fn_divide:
+		case token::types::fn_modulo:
+		case token::types::fn_min:
+		case token::types::fn_max:
+		case token::types::fn_abs:
+		case token::types::fn_clamp:
+		case token::types::fn_string_length:
+		case token::types::fn_substring:
+		case token::types::fn_string_find:
+		case token::types::fn_starts_with:
+		case token::types::fn_string_compare:
+		case token::types::fn_to_int:
+		case token::types::fn_to_double:
+		case token::types::fn_to_string:
+		case token::types::fn_format:
 			return true;
 		default:
 			return false;
@@ -778,6 +1250,13 @@ bool parser::is_built_in_procedure(
 		case token::types::pr_host_add:
 		case token::types::pr_host_delete:
 		case token::types::pr_host_do:
+		case token::types::pr_post:
+		case token::types::pr_array_set:
+		case token::types::pr_array_push:
+		case token::types::pr_struct_set:
+		case token::types::pr_map_set:
+		case token::types::pr_map_erase:
+		case token::types::pr_builder_append:
 			return true;
 		default:
 			return false;
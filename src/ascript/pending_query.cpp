@@ -0,0 +1,90 @@
+#include "ascript/pending_query.h"
+#include "ascript/host.h"
+#include "ascript/error.h"
+
+using namespace ascript;
+
+void pending_query::complete(
+	const variable& _value
+) {
+
+	//The completing thread might keep its handles, the script gets clones.
+	variable copy=_value.clone();
+
+	std::unique_lock<std::mutex> lock{mutex};
+	if(done) {
+
+		error_builder::get()<<"query was already completed"<<throw_err{0, throw_err::types::host};
+	}
+
+	value=std::move(copy);
+	finish(lock);
+}
+
+void pending_query::fail(
+	const std::string& _error
+) {
+
+	std::unique_lock<std::mutex> lock{mutex};
+	if(done) {
+
+		error_builder::get()<<"query was already completed"<<throw_err{0, throw_err::types::host};
+	}
+
+	failed=true;
+	error=_error;
+	finish(lock);
+}
+
+bool pending_query::is_done() const {
+
+	std::lock_guard<std::mutex> lock{mutex};
+	return done;
+}
+
+bool pending_query::is_failed() const {
+
+	std::lock_guard<std::mutex> lock{mutex};
+	return failed;
+}
+
+void pending_query::set_callback(
+	std::function<void()> _callback
+) {
+
+	std::unique_lock<std::mutex> lock{mutex};
+	if(!done) {
+
+		callback=std::move(_callback);
+		return;
+	}
+
+	lock.unlock();
+	_callback();
+}
+
+void pending_query::finish(
+	std::unique_lock<std::mutex>& _lock
+) {
+
+	done=true;
+
+	//The callback is called without the lock, so it can look at the query.
+	auto to_call=std::move(callback);
+	callback=nullptr;
+	_lock.unlock();
+
+	if(to_call) {
+
+		to_call();
+	}
+}
+
+std::shared_ptr<pending_query> host::host_query_async(
+	const std::vector<variable>& _arguments
+) const {
+
+	auto result=std::make_shared<pending_query>();
+	result->complete(host_query(_arguments));
+	return result;
+}
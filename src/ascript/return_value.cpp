@@ -26,6 +26,15 @@ return_value::return_value(
 	}
 }
 
+return_value::return_value(
+	yields _yield
+):
+	type{types::yield},
+	preempted{_yield==yields::preemption}
+{
+
+}
+
 return_value::operator bool() const {
 
 	return type==return_value::types::value;
@@ -46,6 +55,11 @@ bool return_value::is_yield() const {
 	return type==return_value::types::yield;
 }
 
+bool return_value::is_preempted() const {
+
+	return preempted;
+}
+
 const variable& return_value::get() const {
 
 	if(type!=return_value::types::value 
@@ -9,10 +9,3 @@ run_context::run_context(
 	host_ptr{_host},
 	out_facility{_out}
 {}
-
-void run_context::reset() {
-
-	signal=signals::none;
-	value={false};
-	arguments.clear();
-}
@@ -0,0 +1,192 @@
+#include "ascript/sharded_environment.h"
+#include "ascript/error.h"
+
+#include <iterator>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace ascript;
+
+sharded_environment::shard::shard(
+	const shard_view& _view,
+	std::size_t _capacity,
+	sharded_environment& _owner
+):
+	env{_view.host_view, _view.out, _capacity},
+	box{_owner}
+{
+
+	env.set_mailbox(&box);
+}
+
+sharded_environment::sharded_environment(
+	const std::vector<shard_view>& _views,
+	std::size_t _capacity
+) {
+
+	if(_views.empty()) {
+
+		error_builder::get()<<"a sharded environment needs at least one shard"<<throw_err{0, throw_err::types::user};
+	}
+
+	for(const auto& view : _views) {
+
+		shards.emplace_back(new shard{view, _capacity, *this});
+	}
+
+	const std::size_t cores=std::thread::hardware_concurrency();
+	for(std::size_t i=0; i<shards.size(); i++) {
+
+		shards[i]->thread=std::thread(&sharded_environment::work, this, i);
+
+#ifdef __linux__
+		//Affinity is a hint: if it cannot be set the shard runs anywhere.
+		if(cores) {
+
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(i % cores, &set);
+			pthread_setaffinity_np(shards[i]->thread.native_handle(), sizeof(cpu_set_t), &set);
+		}
+#else
+		(void)cores;
+#endif
+	}
+}
+
+sharded_environment::~sharded_environment() {
+
+	{
+		std::lock_guard<std::mutex> lock(tick_mutex);
+		stopping=true;
+	}
+
+	tick_start.notify_all();
+	for(auto& s : shards) {
+
+		s->thread.join();
+	}
+}
+
+void sharded_environment::load(
+	const std::string& _filename
+) {
+
+	for(auto& s : shards) {
+
+		s->env.load(_filename);
+	}
+}
+
+bool sharded_environment::submit(
+	std::size_t _key,
+	run_request& _request
+) {
+
+	return shards[get_shard_index(_key)]->env.submit(_request);
+}
+
+std::vector<shard_tick> sharded_environment::run_all_ready() {
+
+	pending=shards.size();
+
+	{
+		std::unique_lock<std::mutex> lock(tick_mutex);
+		++tick;
+		tick_start.notify_all();
+		tick_end.wait(lock, [this]() {return 0==pending;});
+	}
+
+	events.clear();
+
+	std::vector<shard_tick> result;
+	result.reserve(shards.size());
+	for(auto& s : shards) {
+
+		result.push_back(std::move(s->last_tick));
+		s->last_tick=shard_tick{};
+	}
+
+	return result;
+}
+
+void sharded_environment::work(
+	std::size_t _index
+) {
+
+	std::size_t last_tick=0;
+	while(true) {
+
+		{
+			std::unique_lock<std::mutex> lock(tick_mutex);
+			tick_start.wait(lock, [this, last_tick]() {return stopping || tick!=last_tick;});
+			if(stopping) {
+
+				return;
+			}
+
+			last_tick=tick;
+		}
+
+		run_tick(*shards[_index]);
+
+		if(1==pending.fetch_sub(1)) {
+
+			std::lock_guard<std::mutex> lock(tick_mutex);
+			tick_end.notify_one();
+		}
+	}
+}
+
+void sharded_environment::run_tick(
+	shard& _shard
+) {
+
+	auto& report=_shard.last_tick;
+
+	//Only what is queued now: messages posted during this tick, even by
+	//this same shard, are run on the next one.
+	report.drained=_shard.env.drain_submissions(_shard.env.get_submission_count());
+
+	//Failures come back as entries with an error, among the rest.
+	auto add=[&report](std::vector<resumed_interpreter>&& _resumed) {
+
+		report.resumed.insert(std::end(report.resumed), std::make_move_iterator(std::begin(_resumed)), std::make_move_iterator(std::end(_resumed)));
+	};
+
+	for(const auto& event : events) {
+
+		add(_shard.env.signal(event));
+	}
+
+	add(_shard.env.resume_ready());
+	add(_shard.env.resume_completed());
+}
+
+void sharded_environment::shard_mailbox::post(
+	std::size_t _key,
+	const std::string& _function,
+	const std::vector<variable>& _arguments
+) {
+
+	//Messages have no sender waiting for them, so their errors are reported
+	//by the receiving shard, from its own thread.
+	const std::size_t index=owner.get_shard_index(_key);
+	auto * report=&owner.shards[index]->last_tick;
+	//Submitting clones the arguments, so the sender keeps its handles.
+	run_request request{_function, _arguments, [report](const run_result& _result) {
+
+		if(_result.error.size()) {
+
+			report->errors.push_back(_result.error);
+		}
+	}};
+
+	if(!owner.shards[index]->env.submit(request)) {
+
+		error_builder::get()<<"cannot post to '"<<_function<<"', the queue of shard "<<index<<" is full"<<throw_err{0, throw_err::types::user};
+	}
+}
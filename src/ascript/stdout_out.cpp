@@ -1,4 +1,8 @@
 #include "ascript/stdout_out.h"
+#include "ascript/array.h"
+#include "ascript/structure.h"
+#include "ascript/map.h"
+#include "ascript/string_builder.h"
 
 #include <iostream>
 #include <stdexcept>
@@ -11,10 +15,59 @@ void stdout_out::out(
 
 	//The overloads are, so far, for debugging purposes so...
 	switch(_arg.type) {
-		case variable::types::boolean: std::cout<<(_arg.bool_val ? "true" : "false"); break;
-		case variable::types::integer: std::cout<<_arg.int_val; break;
-		case variable::types::string: std::cout<<_arg.str_val; break;
-		case variable::types::decimal: std::cout<<_arg.double_val; break;
+		case variable::types::boolean: std::cout<<(_arg.get_bool() ? "true" : "false"); break;
+		case variable::types::integer: std::cout<<_arg.get_int(); break;
+		case variable::types::string: std::cout<<_arg.get_string(); break;
+		case variable::types::decimal: std::cout<<_arg.get_double(); break;
+		case variable::types::array: {
+
+			const auto& elements=*_arg.get_array();
+			std::cout<<"[";
+			for(std::size_t i=0; i<elements.size(); i++) {
+
+				if(i) {
+					std::cout<<", ";
+				}
+
+				out(elements.get(i));
+			}
+			std::cout<<"]";
+		}
+		break;
+		case variable::types::structure: {
+
+			const auto& fields=*_arg.get_struct();
+			std::cout<<fields.get_type().name<<"{";
+			for(std::size_t i=0; i<fields.size(); i++) {
+
+				if(i) {
+					std::cout<<", ";
+				}
+
+				out(fields.get(i));
+			}
+			std::cout<<"}";
+		}
+		break;
+		case variable::types::map: {
+
+			bool first=true;
+			std::cout<<"{";
+			_arg.get_map()->for_each([&](const variable& _key, const variable& _value) {
+
+				if(!first) {
+					std::cout<<", ";
+				}
+
+				out(_key);
+				std::cout<<": ";
+				out(_value);
+				first=false;
+			});
+			std::cout<<"}";
+		}
+		break;
+		case variable::types::builder: std::cout<<_arg.get_builder()->view(); break;
 		case variable::types::symbol: 
 			throw std::runtime_error("should never happen");
 	}
@@ -0,0 +1,70 @@
+#include "ascript/string_builder.h"
+
+#include <stdexcept>
+#include <charconv>
+#include <cstring>
+
+using namespace ascript;
+
+std::string_view string_builder::write(
+	const variable& _value,
+	char * _buffer
+) {
+
+	switch(_value.type) {
+
+		case variable::types::string:
+			return _value.get_string();
+		case variable::types::boolean:
+			return _value.get_bool() ? "true" : "false";
+		case variable::types::integer: {
+
+			const auto written=std::to_chars(_buffer, _buffer+number_capacity, _value.get_int());
+			return {_buffer, (std::size_t)(written.ptr-_buffer)};
+		}
+		case variable::types::decimal: {
+
+			//The shortest form has no dot for integral values, nor for
+			//exponents, infinities and nans.
+			auto end=std::to_chars(_buffer, _buffer+number_capacity, _value.get_double()).ptr;
+			if(std::string_view::npos==std::string_view(_buffer, end-_buffer).find_first_of(".en")) {
+
+				*end++='.';
+				*end++='0';
+			}
+
+			return {_buffer, (std::size_t)(end-_buffer)};
+		}
+		case variable::types::builder:
+			return _value.get_builder()->view();
+		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+			break;
+	}
+
+	throw std::runtime_error("only booleans, integers, doubles, strings and builders can be written as text");
+}
+
+void string_builder::append(
+	const variable& _value
+) {
+
+	char buffer[number_capacity];
+	append(write(_value, buffer));
+}
+
+variable string_builder::freeze() {
+
+	auto result=variable::build_string(text.size(), [this](char * _out) {
+
+		if(text.size()) {
+
+			std::memcpy(_out, text.data(), text.size());
+		}
+	});
+
+	text.clear();
+	return result;
+}
@@ -0,0 +1,135 @@
+#include "ascript/structure.h"
+#include "ascript/array.h"
+#include "ascript/string_builder.h"
+
+#include <stdexcept>
+#include <string>
+#include <new>
+
+using namespace ascript;
+
+//Fields follow the header in the same allocation.
+static_assert(sizeof(structure) % alignof(variable)==0, "struct fields would be misaligned");
+
+//!Returns the value a field of the given type starts with.
+static variable default_value(
+	parameter::types _type
+) {
+
+	switch(_type) {
+
+		case parameter::types::integer: return 0;
+		case parameter::types::decimal: return 0.;
+		case parameter::types::string: return std::string_view{};
+		case parameter::types::array: return array{};
+		case parameter::types::builder: return string_builder{};
+		case parameter::types::boolean:
+		case parameter::types::structure:
+		case parameter::types::map:
+		case parameter::types::any:
+			break;
+	}
+
+	return false;
+}
+
+structure::structure(
+	std::shared_ptr<const struct_type> _type
+):
+	type{std::move(_type)}
+{}
+
+structure::~structure() {
+
+	for(std::size_t i=0; i<size(); i++) {
+
+		fields()[i].~variable();
+	}
+}
+
+structure * structure::create(
+	std::shared_ptr<const struct_type> _type
+) {
+
+	const std::size_t count=_type->fields.size();
+	void * memory=::operator new(sizeof(structure)+count*sizeof(variable));
+	auto * result=new (memory) structure{std::move(_type)};
+
+	for(std::size_t i=0; i<count; i++) {
+
+		new (result->fields()+i) variable{default_value(result->type->fields[i].type)};
+	}
+
+	return result;
+}
+
+void structure::destroy(
+	structure * _struct
+) {
+
+	_struct->~structure();
+	::operator delete(_struct);
+}
+
+const variable& structure::get(
+	std::string_view _name
+) const {
+
+	return get(index_of(_name));
+}
+
+void structure::set(
+	std::size_t _index,
+	const variable& _value
+) {
+
+	const auto& field=type->fields[_index];
+	bool matches=false;
+
+	switch(field.type) {
+
+		case parameter::types::integer: matches=variable::types::integer==_value.type; break;
+		case parameter::types::decimal: matches=variable::types::decimal==_value.type; break;
+		case parameter::types::boolean: matches=variable::types::boolean==_value.type; break;
+		case parameter::types::string: matches=variable::types::string==_value.type; break;
+		case parameter::types::array: matches=variable::types::array==_value.type; break;
+		case parameter::types::builder: matches=variable::types::builder==_value.type; break;
+		case parameter::types::structure:
+		case parameter::types::map:
+			matches=false;
+		break;
+		case parameter::types::any:
+			matches=variable::types::symbol!=_value.type 
+				&& variable::types::structure!=_value.type
+				&& variable::types::map!=_value.type;
+		break;
+	}
+
+	if(!matches) {
+
+		throw std::runtime_error("type mismatch for field "+type->name+"."+field.name);
+	}
+
+	fields()[_index]=_value;
+}
+
+void structure::set(
+	std::string_view _name,
+	const variable& _value
+) {
+
+	set(index_of(_name), _value);
+}
+
+std::size_t structure::index_of(
+	std::string_view _name
+) const {
+
+	const int index=type->find(_name);
+	if(-1==index) {
+
+		throw std::runtime_error(type->name+" has no field "+std::string{_name});
+	}
+
+	return index;
+}
@@ -0,0 +1,65 @@
+#include "ascript/symbol_table.h"
+
+#include <utility>
+
+using namespace ascript;
+
+const variable * symbol_table::find(
+	std::string_view _name
+) const {
+
+	for(const auto& sym : symbols) {
+
+		if(sym.name==_name) {
+
+			return &sym.value;
+		}
+	}
+
+	return nullptr;
+}
+
+variable * symbol_table::find(
+	std::string_view _name
+) {
+
+	for(auto& sym : symbols) {
+
+		if(sym.name==_name) {
+
+			return &sym.value;
+		}
+	}
+
+	return nullptr;
+}
+
+void symbol_table::insert(
+	const std::string& _name,
+	variable _value
+) {
+
+	symbols.push_back({_name, std::move(_value)});
+}
+
+void symbol_table::update_from(
+	symbol_table& _other
+) {
+
+	std::size_t index=0;
+	for(auto& sym : symbols) {
+
+		//Tables of inner blocks start as a copy of the outer one, so the 
+		//same symbol is usually found at the same position.
+		if(index < _other.symbols.size() && _other.symbols[index].name==sym.name) {
+
+			sym.value=std::move(_other.symbols[index].value);
+		}
+		else if(auto * value=_other.find(sym.name)) {
+
+			sym.value=std::move(*value);
+		}
+
+		++index;
+	}
+}
@@ -0,0 +1,55 @@
+#include "ascript/time_source.h"
+
+using namespace ascript;
+
+const time_source& ascript::get_default_time_source() {
+
+	static const steady_time_source default_source;
+	return default_source;
+}
+
+pausable_time_source::pausable_time_source(
+	const time_source& _source
+):
+	source{&_source}
+{
+
+}
+
+time_source::time_point pausable_time_source::now() const {
+
+	return (paused ? pause_time : source->now())-offset;
+}
+
+void pausable_time_source::pause() {
+
+	if(paused) {
+
+		return;
+	}
+
+	pause_time=source->now();
+	paused=true;
+}
+
+void pausable_time_source::unpause() {
+
+	if(!paused) {
+
+		return;
+	}
+
+	offset+=source->now()-pause_time;
+	paused=false;
+}
+
+void pausable_time_source::set_source(
+	const time_source& _source
+) {
+
+	source=&_source;
+	if(paused) {
+
+		pause_time=source->now();
+	}
+}
@@ -18,17 +18,55 @@ std::string ascript::type_to_str(
 		case token::types::fn_add: return "fn_add";
 		case token::types::fn_substract: return "fn_substract";
 		case token::types::fn_concatenate: return "fn_concatenate";
+		case token::types::fn_multiply: return "fn_multiply";
+		case token::types::fn_divide: return "fn_divide";
+		case token::types::fn_modulo: return "fn_modulo";
+		case token::types::fn_min: return "fn_min";
+		case token::types::fn_max: return "fn_max";
+		case token::types::fn_abs: return "fn_abs";
+		case token::types::fn_clamp: return "fn_clamp";
+		case token::types::fn_string_length: return "fn_string_length";
+		case token::types::fn_substring: return "fn_substring";
+		case token::types::fn_string_find: return "fn_string_find";
+		case token::types::fn_starts_with: return "fn_starts_with";
+		case token::types::fn_string_compare: return "fn_string_compare";
+		case token::types::fn_to_int: return "fn_to_int";
+		case token::types::fn_to_double: return "fn_to_double";
+		case token::types::fn_to_string: return "fn_to_string";
+		case token::types::fn_format: return "fn_format";
+		case token::types::fn_builder: return "fn_builder";
+		case token::types::fn_builder_freeze: return "fn_builder_freeze";
 		case token::types::fn_is_int: return "fn_is_int";
 		case token::types::fn_is_bool: return "fn_is_bool";
 		case token::types::fn_is_double: return "fn_is_double";
 		case token::types::fn_is_string: return "fn_is_string";
+		case token::types::fn_is_array: return "fn_is_array";
+		case token::types::fn_array: return "fn_array";
+		case token::types::fn_array_size: return "fn_array_size";
+		case token::types::fn_array_get: return "fn_array_get";
+		case token::types::fn_array_pop: return "fn_array_pop";
+		case token::types::fn_array_slice: return "fn_array_slice";
+		case token::types::fn_struct_get: return "fn_struct_get";
+		case token::types::fn_is_map: return "fn_is_map";
+		case token::types::fn_map: return "fn_map";
+		case token::types::fn_map_size: return "fn_map_size";
+		case token::types::fn_map_get: return "fn_map_get";
+		case token::types::fn_map_has: return "fn_map_has";
 		case token::types::fn_host_has: return "fn_host_has";
 		case token::types::fn_host_get: return "fn_host_get";
 		case token::types::fn_host_query: return "fn_host_query";
+		case token::types::fn_host_query_async: return "fn_host_query_async";
 		case token::types::pr_host_delete: return "pr_host_delete";
 		case token::types::pr_host_set: return "pr_host_set";
 		case token::types::pr_host_add: return "pr_host_add";
 		case token::types::pr_host_do: return "pr_host_do";
+		case token::types::pr_post: return "pr_post";
+		case token::types::pr_array_set: return "pr_array_set";
+		case token::types::pr_array_push: return "pr_array_push";
+		case token::types::pr_struct_set: return "pr_struct_set";
+		case token::types::pr_map_set: return "pr_map_set";
+		case token::types::pr_map_erase: return "pr_map_erase";
+		case token::types::pr_builder_append: return "pr_builder_append";
 		case token::types::pr_out: return "out";
 		case token::types::pr_fail: return "fail";
 		case token::types::kw_not: return "not";
@@ -41,6 +79,7 @@ std::string ascript::type_to_str(
 		case token::types::kw_endloop: return "endloop";
 		case token::types::kw_yield: return "yield";
 		case token::types::kw_for: return "for";
+		case token::types::kw_until: return "until";
 		case token::types::kw_exit: return "exit";
 		case token::types::kw_return: return "return";
 		case token::types::kw_let: return "let";
@@ -53,6 +92,8 @@ std::string ascript::type_to_str(
 		case token::types::kw_double: return "kw_double";
 		case token::types::kw_anytype: return "kw_anytype";
 		case token::types::kw_as: return "as";
+		case token::types::kw_struct: return "struct";
+		case token::types::kw_new: return "new";
 		case token::types::kw_beginfunction: return "beginfunction";
 		case token::types::kw_endfunction: return "endfunction";
 		case token::types::semicolon: return ";";
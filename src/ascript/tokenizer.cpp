@@ -1,4 +1,5 @@
 #include "ascript/tokenizer.h"
+#include "ascript/error.h"
 
 #include <tools/file_utils.h>
 #include <tools/string_utils.h>
@@ -6,6 +7,7 @@
 
 #include <sstream>
 #include <cstdlib>
+#include <cerrno>
 
 using namespace ascript;
 
@@ -18,6 +20,7 @@ tokenizer::tokenizer() {
 	typemap["is_bool"]=token::types::fn_is_bool;
 	typemap["is_double"]=token::types::fn_is_double;
 	typemap["is_string"]=token::types::fn_is_string;
+	typemap["is_array"]=token::types::fn_is_array;
 	typemap["not"]=token::types::kw_not;
 	typemap["if"]=token::types::kw_if;
 	typemap["elseif"]=token::types::kw_elseif;
@@ -28,6 +31,7 @@ tokenizer::tokenizer() {
 	typemap["endloop"]=token::types::kw_endloop;
 	typemap["yield"]=token::types::kw_yield;
 	typemap["for"]=token::types::kw_for;
+	typemap["until"]=token::types::kw_until;
 	typemap["return"]=token::types::kw_return;
 	typemap["fail"]=token::types::pr_fail;
 	typemap["let"]=token::types::kw_let;
@@ -43,13 +47,52 @@ tokenizer::tokenizer() {
 	typemap["add"]=token::types::fn_add;
 	typemap["substract"]=token::types::fn_substract;
 	typemap["concatenate"]=token::types::fn_concatenate;
+	typemap["multiply"]=token::types::fn_multiply;
+	typemap["divide"]=token::types::fn_divide;
+	typemap["modulo"]=token::types::fn_modulo;
+	typemap["min"]=token::types::fn_min;
+	typemap["max"]=token::types::fn_max;
+	typemap["abs"]=token::types::fn_abs;
+	typemap["clamp"]=token::types::fn_clamp;
+	typemap["string_length"]=token::types::fn_string_length;
+	typemap["substring"]=token::types::fn_substring;
+	typemap["string_find"]=token::types::fn_string_find;
+	typemap["starts_with"]=token::types::fn_starts_with;
+	typemap["string_compare"]=token::types::fn_string_compare;
+	typemap["to_int"]=token::types::fn_to_int;
+	typemap["to_double"]=token::types::fn_to_double;
+	typemap["to_string"]=token::types::fn_to_string;
+	typemap["format"]=token::types::fn_format;
+	typemap["builder"]=token::types::fn_builder;
+	typemap["builder_freeze"]=token::types::fn_builder_freeze;
+	typemap["array"]=token::types::fn_array;
+	typemap["array_size"]=token::types::fn_array_size;
+	typemap["array_get"]=token::types::fn_array_get;
+	typemap["array_set"]=token::types::pr_array_set;
+	typemap["array_push"]=token::types::pr_array_push;
+	typemap["array_pop"]=token::types::fn_array_pop;
+	typemap["array_slice"]=token::types::fn_array_slice;
+	typemap["struct"]=token::types::kw_struct;
+	typemap["new"]=token::types::kw_new;
+	typemap["struct_get"]=token::types::fn_struct_get;
+	typemap["struct_set"]=token::types::pr_struct_set;
+	typemap["is_map"]=token::types::fn_is_map;
+	typemap["map"]=token::types::fn_map;
+	typemap["map_size"]=token::types::fn_map_size;
+	typemap["map_get"]=token::types::fn_map_get;
+	typemap["map_has"]=token::types::fn_map_has;
+	typemap["map_set"]=token::types::pr_map_set;
+	typemap["map_erase"]=token::types::pr_map_erase;
+	typemap["builder_append"]=token::types::pr_builder_append;
 	typemap["host_has"]=token::types::fn_host_has;
 	typemap["host_add"]=token::types::pr_host_add;
 	typemap["host_get"]=token::types::fn_host_get;
 	typemap["host_set"]=token::types::pr_host_set;
 	typemap["host_delete"]=token::types::pr_host_delete;
 	typemap["host_query"]=token::types::fn_host_query;
+	typemap["host_query_async"]=token::types::fn_host_query_async;
 	typemap["host_do"]=token::types::pr_host_do;
+	typemap["post"]=token::types::pr_post;
 	typemap["out"]=token::types::pr_out;
 	typemap["beginfunction"]=token::types::kw_beginfunction;
 	typemap["endfunction"]=token::types::kw_endfunction;
@@ -332,14 +375,21 @@ bool tokenizer::try_integer(
 ) {
 
 	char * c;
-	long int n = std::strtol(_strtoken.c_str(), &c, 10);
-	if(*c == 0) {
+	errno=0;
+	long long int n = std::strtoll(_strtoken.c_str(), &c, 10);
+	if(*c != 0) {
 
-		_result.push_back({token::types::val_int, "", (int)n, 0.0, false, _line_number});
-		return true;
+		return false;
 	}
 
-	return false;
+	//Rather than quietly turning into a double.
+	if(ERANGE==errno) {
+
+		error_builder::get()<<"integer literal "<<_strtoken<<" does not fit in 64 bits"<<throw_err{_line_number, throw_err::types::parser};
+	}
+
+	_result.push_back({token::types::val_int, "", n, 0.0, false, _line_number});
+	return true;
 }
 
 bool tokenizer::try_double(
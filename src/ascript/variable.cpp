@@ -1,76 +1,367 @@
 #include "ascript/variable.h"
+#include "ascript/array.h"
+#include "ascript/map.h"
+#include "ascript/structure.h"
+#include "ascript/string_builder.h"
 
 #include <stdexcept>
+#include <atomic>
+#include <new>
+#include <cstring>
+#include <cmath>
+#include <limits>
 
 using namespace ascript;
 
+//!Characters follow the header in the same allocation.
+struct variable::string_buffer {
+
+	std::atomic<std::uint32_t>  references;
+	std::size_t                 size;
+
+	char *                      data() {return reinterpret_cast<char *>(this+1);}
+
+	//!Returns a new buffer for the given number of characters, yet to be
+	//!written, and one reference.
+	static string_buffer *      create(std::size_t _size) {
+
+		void * memory=::operator new(sizeof(string_buffer)+_size);
+		return new (memory) string_buffer{{1}, _size};
+	}
+};
+
+//!The value follows its reference count.
+template<typename T> struct variable::shared_value {
+
+	std::atomic<std::uint32_t>  references;
+	T                           value;
+};
+
 variable::variable(
 	bool _val
 ):
-	type{types::boolean},
-	bool_val{_val},
-	int_val{0},
-	double_val{0.}
-{}
+	storage{},
+	type{types::boolean}
+{
+	store(_val);
+}
 
 variable::variable(
-	int _val
+	long long _val
 ):
-	type{types::integer},
-	bool_val{false},
-	int_val{_val},
-	double_val{0.}
-{}
+	storage{},
+	type{types::integer}
+{
+	store<std::int64_t>(_val);
+}
 
 variable::variable(
 	double _val
 ):
-	type{types::decimal},
-	bool_val{false},
-	int_val{0},
-	double_val{_val}
-{}
+	storage{},
+	type{types::decimal}
+{
+	store(_val);
+}
 
 variable::variable(
 	const std::string& _val
 ):
-	type{types::string},
-	bool_val{false},
-	int_val{0},
-	double_val{0.},
-	str_val{_val}
+	variable{std::string_view{_val}}
 {}
 
+variable::variable(
+	std::string_view _val
+):
+	storage{},
+	type{types::string}
+{
+	assign_string(_val);
+}
+
 variable::variable(
 	const char _val
 ):
-	type{types::string},
-	bool_val{false},
-	int_val{0},
-	double_val{0.},
-	str_val{_val}
-{}
+	storage{},
+	type{types::string}
+{
+	assign_string({&_val, 1});
+}
 
 variable::variable(
 	const char * _val
 ):
-	type{types::string},
-	bool_val{false},
-	int_val{0},
-	double_val{0.},
-	str_val{_val}
-{}
+	storage{},
+	type{types::string}
+{
+	assign_string(_val);
+}
 
 variable::variable(
-	const std::string& _identifier,
+	std::string_view _identifier,
 	types /*_unused*/
 ):
-	type{types::symbol},
-	bool_val{false},
-	int_val{0},
-	double_val{0.},
-	str_val{_identifier}
-{}
+	storage{},
+	type{types::symbol}
+{
+	assign_string(_identifier);
+}
+
+variable::variable(
+	ascript::array&& _val
+):
+	storage{},
+	type{types::array}
+{
+	store(new shared_value<ascript::array>{{1}, std::move(_val)});
+	small_size=heap_size;
+}
+
+variable::variable(
+	ascript::map&& _val
+):
+	storage{},
+	type{types::map}
+{
+	store(new shared_value<ascript::map>{{1}, std::move(_val)});
+	small_size=heap_size;
+}
+
+variable::variable(
+	ascript::string_builder&& _val
+):
+	storage{},
+	type{types::builder}
+{
+	store(new shared_value<ascript::string_builder>{{1}, std::move(_val)});
+	small_size=heap_size;
+}
+
+variable::variable(
+	std::shared_ptr<const struct_type> _type
+):
+	storage{},
+	type{types::structure}
+{
+	store(structure::create(std::move(_type)));
+	small_size=heap_size;
+}
+
+variable::variable(
+	const variable& _other
+):
+	small_size{_other.small_size},
+	type{_other.type}
+{
+	std::memcpy(storage, _other.storage, small_capacity);
+	acquire();
+}
+
+variable::variable(
+	variable&& _other
+) noexcept:
+	small_size{_other.small_size},
+	type{_other.type}
+{
+	std::memcpy(storage, _other.storage, small_capacity);
+
+	//The buffer changes hands, the moved from variable becomes false.
+	_other.small_size=0;
+	_other.type=types::boolean;
+	_other.store(false);
+}
+
+variable& variable::operator=(
+	const variable& _other
+) {
+
+	if(this==&_other) {
+
+		return *this;
+	}
+
+	_other.acquire();
+	release();
+	std::memcpy(storage, _other.storage, small_capacity);
+	small_size=_other.small_size;
+	type=_other.type;
+	return *this;
+}
+
+variable& variable::operator=(
+	variable&& _other
+) noexcept {
+
+	if(this==&_other) {
+
+		return *this;
+	}
+
+	release();
+	std::memcpy(storage, _other.storage, small_capacity);
+	small_size=_other.small_size;
+	type=_other.type;
+
+	_other.small_size=0;
+	_other.type=types::boolean;
+	_other.store(false);
+	return *this;
+}
+
+std::string_view variable::get_string() const {
+
+	if(types::string!=type && types::symbol!=type) {
+
+		return {};
+	}
+
+	if(auto * buffer=get_buffer()) {
+
+		return {buffer->data(), buffer->size};
+	}
+
+	return {storage, small_size};
+}
+
+void variable::assign_string(
+	std::string_view _str
+) {
+
+	char * out=reserve_string(_str.size());
+	if(_str.size()) {
+
+		std::memcpy(out, _str.data(), _str.size());
+	}
+}
+
+char * variable::reserve_string(
+	std::size_t _length
+) {
+
+	if(_length <= small_capacity) {
+
+		small_size=_length;
+		return storage;
+	}
+
+	auto * buffer=string_buffer::create(_length);
+	store(buffer);
+	small_size=heap_size;
+	return buffer->data();
+}
+
+ascript::array * variable::get_array() const {
+
+	return types::array==type ? &load<shared_value<ascript::array> *>()->value : nullptr;
+}
+
+ascript::map * variable::get_map() const {
+
+	return types::map==type ? &load<shared_value<ascript::map> *>()->value : nullptr;
+}
+
+ascript::string_builder * variable::get_builder() const {
+
+	return types::builder==type ? &load<shared_value<ascript::string_builder> *>()->value : nullptr;
+}
+
+ascript::structure * variable::get_struct() const {
+
+	return types::structure==type ? load<ascript::structure *>() : nullptr;
+}
+
+variable::string_buffer * variable::get_buffer() const {
+
+	return heap_size==small_size && (types::string==type || types::symbol==type) ? load<string_buffer *>() : nullptr;
+}
+
+void variable::acquire() const {
+
+	if(heap_size!=small_size) {
+
+		return;
+	}
+
+	switch(type) {
+
+		case types::array:
+			load<shared_value<ascript::array> *>()->references.fetch_add(1, std::memory_order_relaxed);
+		break;
+		case types::map:
+			load<shared_value<ascript::map> *>()->references.fetch_add(1, std::memory_order_relaxed);
+		break;
+		case types::structure:
+			load<ascript::structure *>()->references.fetch_add(1, std::memory_order_relaxed);
+		break;
+		case types::builder:
+			load<shared_value<ascript::string_builder> *>()->references.fetch_add(1, std::memory_order_relaxed);
+		break;
+		default:
+			load<string_buffer *>()->references.fetch_add(1, std::memory_order_relaxed);
+		break;
+	}
+}
+
+void variable::release() {
+
+	if(heap_size!=small_size) {
+
+		return;
+	}
+
+	if(types::array==type) {
+
+		auto * buffer=load<shared_value<ascript::array> *>();
+		if(1==buffer->references.fetch_sub(1, std::memory_order_acq_rel)) {
+
+			delete buffer;
+		}
+
+		return;
+	}
+
+	if(types::map==type) {
+
+		auto * buffer=load<shared_value<ascript::map> *>();
+		if(1==buffer->references.fetch_sub(1, std::memory_order_acq_rel)) {
+
+			delete buffer;
+		}
+
+		return;
+	}
+
+	if(types::builder==type) {
+
+		auto * buffer=load<shared_value<ascript::string_builder> *>();
+		if(1==buffer->references.fetch_sub(1, std::memory_order_acq_rel)) {
+
+			delete buffer;
+		}
+
+		return;
+	}
+
+	if(types::structure==type) {
+
+		auto * fields=load<ascript::structure *>();
+		if(1==fields->references.fetch_sub(1, std::memory_order_acq_rel)) {
+
+			structure::destroy(fields);
+		}
+
+		return;
+	}
+
+	auto * buffer=load<string_buffer *>();
+	if(1!=buffer->references.fetch_sub(1, std::memory_order_acq_rel)) {
+
+		return;
+	}
+
+	buffer->~string_buffer();
+	::operator delete(buffer);
+}
 
 std::ostream& ascript::operator<<(
 	std::ostream& _stream, 
@@ -80,26 +371,63 @@ std::ostream& ascript::operator<<(
 	switch(_var.type) {
 
 		case variable::types::integer:
-			_stream<<"integer:"<<_var.int_val;
+			_stream<<"integer:"<<_var.get_int();
 			return _stream;
 		case variable::types::boolean:
-			_stream<<"boolean:"<<_var.bool_val;
+			_stream<<"boolean:"<<_var.get_bool();
 			return _stream;
 		case variable::types::string:
-			_stream<<"string:"<<_var.str_val;
+			_stream<<"string:"<<_var.get_string();
 			return _stream;
 		case variable::types::decimal:
-			_stream<<"double:"<<_var.double_val;
+			_stream<<"double:"<<_var.get_double();
 			return _stream;
 		case variable::types::symbol:
-			_stream<<"symbol:"<<_var.str_val;
+			_stream<<"symbol:"<<_var.get_string();
+			return _stream;
+		case variable::types::array: {
+
+			const auto& elements=*_var.get_array();
+			_stream<<"array:[";
+			for(std::size_t i=0; i<elements.size(); i++) {
+
+				_stream<<(i ? ", " : "")<<elements.get(i);
+			}
+			_stream<<"]";
+			return _stream;
+		}
+		case variable::types::structure: {
+
+			const auto& fields=*_var.get_struct();
+			_stream<<"struct:"<<fields.get_type().name<<"{";
+			for(std::size_t i=0; i<fields.size(); i++) {
+
+				_stream<<(i ? ", " : "")<<fields.get_type().fields[i].name<<":"<<fields.get(i);
+			}
+			_stream<<"}";
+			return _stream;
+		}
+		case variable::types::map: {
+
+			bool first=true;
+			_stream<<"map:{";
+			_var.get_map()->for_each([&](const variable& _key, const variable& _value) {
+
+				_stream<<(first ? "" : ", ")<<_key<<" => "<<_value;
+				first=false;
+			});
+			_stream<<"}";
+			return _stream;
+		}
+		case variable::types::builder:
+			_stream<<"builder:"<<_var.get_builder()->view();
 			return _stream;
 	}
 	
 	return _stream;
 }
 
-bool variable::operator==(
+bool variable::equals(
 	const variable& _other
 ) const {
 
@@ -111,20 +439,29 @@ bool variable::operator==(
 	switch(type) {
 
 		case variable::types::integer:
-			return int_val==_other.int_val;
+			return get_int()==_other.get_int();
 		case variable::types::boolean:
-			return bool_val==_other.bool_val;
+			return get_bool()==_other.get_bool();
 		case variable::types::string:
 		case variable::types::symbol:
-			return str_val==_other.str_val;
+			return get_string()==_other.get_string();
 		case variable::types::decimal:
-			return double_val==_other.double_val;
+			return get_double()==_other.get_double();
+		case variable::types::array:
+			//Arrays, structs, maps and builders are handles, equal if they share the elements.
+			return get_array()==_other.get_array();
+		case variable::types::structure:
+			return get_struct()==_other.get_struct();
+		case variable::types::map:
+			return get_map()==_other.get_map();
+		case variable::types::builder:
+			return get_builder()==_other.get_builder();
 	}
 
 	return false;
 }
 
-bool variable::operator<(
+bool variable::lesser_than(
 	const variable& _other
 ) const {
 
@@ -136,19 +473,23 @@ bool variable::operator<(
 	switch(type) {
 
 		case variable::types::integer:
-			return int_val < _other.int_val;
+			return get_int() < _other.get_int();
 		case variable::types::decimal:
-			return double_val < _other.double_val;
+			return get_double() < _other.get_double();
 		case variable::types::boolean:
 		case variable::types::string:
 		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+		case variable::types::builder:
 			throw std::runtime_error("lesser than is only applicable to numeric types");
 	}
 
 	return false;
 }
 
-bool variable::operator>(
+bool variable::greater_than(
 	const variable& _other
 ) const {
 
@@ -160,12 +501,16 @@ bool variable::operator>(
 	switch(type) {
 
 		case variable::types::integer:
-			return int_val > _other.int_val;
+			return get_int() > _other.get_int();
 		case variable::types::decimal:
-			return double_val > _other.double_val;
+			return get_double() > _other.get_double();
 		case variable::types::boolean:
 		case variable::types::string:
 		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+		case variable::types::builder:
 			throw std::runtime_error("greater than is only applicable to numeric types");
 	}
 
@@ -174,7 +519,24 @@ bool variable::operator>(
 
 variable variable::operator+(
 	const variable& _other
-) const {
+) const& {
+
+	variable result{*this};
+	result+=_other;
+	return result;
+}
+
+variable variable::operator+(
+	const variable& _other
+) && {
+
+	*this+=_other;
+	return std::move(*this);
+}
+
+variable& variable::add_slow(
+	const variable& _other
+) {
 
 	if(type!=_other.type) {
 
@@ -184,16 +546,22 @@ variable variable::operator+(
 	switch(type) {
 
 		case variable::types::integer:
-			return int_val+_other.int_val;
+			//Only overflows under a checked policy get here.
+			throw std::runtime_error("integer overflow in addition");
 		case variable::types::decimal:
-			return double_val+_other.double_val;
+			store(get_double()+_other.get_double());
+			return *this;
 		case variable::types::string:
 		case variable::types::boolean:
 		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+		case variable::types::builder:
 			throw std::runtime_error("addition is only applicable to numeric types");
 	}
 
-	return false;
+	return *this;
 }
 
 variable variable::concatenate(
@@ -207,21 +575,91 @@ variable variable::concatenate(
 
 	switch(type) {
 
-		case variable::types::string:
-			return str_val+_other.str_val;
+		case variable::types::string: {
+
+			const auto left=get_string(), right=_other.get_string();
+			return build_string(left.size()+right.size(), [&](char * _out) {
+
+				std::memcpy(_out, left.data(), left.size());
+				std::memcpy(_out+left.size(), right.data(), right.size());
+			});
+		}
 		case variable::types::integer:
 		case variable::types::decimal:
 		case variable::types::boolean:
 		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+		case variable::types::builder:
 			throw std::runtime_error("concatenation is only applicable to string types");
 	}
 
 	return false;
 }
 
+variable variable::clone() const {
+
+	switch(type) {
+
+		case variable::types::array:
+			//Elements are never handles.
+			return variable{ascript::array{*get_array()}};
+		case variable::types::structure: {
+
+			const auto * original=get_struct();
+			variable result{original->type};
+			for(std::size_t i=0; i<original->size(); i++) {
+
+				result.get_struct()->set(i, original->get(i).clone());
+			}
+
+			return result;
+		}
+		case variable::types::map: {
+
+			ascript::map result;
+			result.reserve(get_map()->size());
+			get_map()->for_each([&result](const variable& _key, const variable& _value) {
+
+				result.set(_key, _value.clone());
+			});
+
+			return variable{std::move(result)};
+		}
+		case variable::types::builder:
+			return variable{ascript::string_builder{*get_builder()}};
+		case variable::types::integer:
+		case variable::types::decimal:
+		case variable::types::boolean:
+		case variable::types::string:
+		case variable::types::symbol:
+			break;
+	}
+
+	return *this;
+}
+
 variable variable::operator-(
 	const variable& _other
-) const {
+) const& {
+
+	variable result{*this};
+	result-=_other;
+	return result;
+}
+
+variable variable::operator-(
+	const variable& _other
+) && {
+
+	*this-=_other;
+	return std::move(*this);
+}
+
+variable& variable::substract_slow(
+	const variable& _other
+) {
 
 	if(type!=_other.type) {
 
@@ -231,14 +669,139 @@ variable variable::operator-(
 	switch(type) {
 
 		case variable::types::integer:
-			return int_val-_other.int_val;
+			throw std::runtime_error("integer overflow in substraction");
 		case variable::types::decimal:
-			return double_val-_other.double_val;
+			store(get_double()-_other.get_double());
+			return *this;
 		case variable::types::boolean:
 		case variable::types::string:
 		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+		case variable::types::builder:
 			throw std::runtime_error("substraction is only applicable to numeric types");
 	}
 
-	return false;
+	return *this;
+}
+
+variable& variable::multiply_slow(
+	const variable& _other
+) {
+
+	if(type!=_other.type) {
+
+		throw std::runtime_error("multiplication type mismatch");
+	}
+
+	switch(type) {
+
+		case variable::types::integer:
+			//Only overflows under a checked policy get here.
+			throw std::runtime_error("integer overflow in multiplication");
+		case variable::types::decimal:
+			store(get_double()*_other.get_double());
+			return *this;
+		case variable::types::boolean:
+		case variable::types::string:
+		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+		case variable::types::builder:
+			throw std::runtime_error("multiplication is only applicable to numeric types");
+	}
+
+	return *this;
+}
+
+variable& variable::divide_slow(
+	const variable& _other,
+	overflow_policy _policy
+) {
+
+	if(type!=_other.type) {
+
+		throw std::runtime_error("division type mismatch");
+	}
+
+	switch(type) {
+
+		case variable::types::integer: {
+
+			const auto divisor=_other.get_int();
+			if(0==divisor) {
+
+				throw std::runtime_error("integer division by zero");
+			}
+
+			//The lowest integer over -1 does not fit, it wraps around to 
+			//itself.
+			if(-1==divisor && std::numeric_limits<std::int64_t>::min()==get_int()) {
+
+				if(overflow_policy::check==_policy) {
+
+					throw std::runtime_error("integer overflow in division");
+				}
+
+				return *this;
+			}
+
+			store(get_int()/divisor);
+			return *this;
+		}
+		case variable::types::decimal:
+			store(get_double()/_other.get_double());
+			return *this;
+		case variable::types::boolean:
+		case variable::types::string:
+		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+		case variable::types::builder:
+			throw std::runtime_error("division is only applicable to numeric types");
+	}
+
+	return *this;
+}
+
+variable& variable::modulo_slow(
+	const variable& _other
+) {
+
+	if(type!=_other.type) {
+
+		throw std::runtime_error("modulo type mismatch");
+	}
+
+	switch(type) {
+
+		case variable::types::integer: {
+
+			const auto divisor=_other.get_int();
+			if(0==divisor) {
+
+				throw std::runtime_error("integer modulo by zero");
+			}
+
+			//Anything modulo -1 is 0, even the lowest integer.
+			store<std::int64_t>(-1==divisor ? 0 : get_int() % divisor);
+			return *this;
+		}
+		case variable::types::decimal:
+			store(std::fmod(get_double(), _other.get_double()));
+			return *this;
+		case variable::types::boolean:
+		case variable::types::string:
+		case variable::types::symbol:
+		case variable::types::array:
+		case variable::types::structure:
+		case variable::types::map:
+		case variable::types::builder:
+			throw std::runtime_error("modulo is only applicable to numeric types");
+	}
+
+	return *this;
 }
@@ -0,0 +1,419 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <new>
+
+#include "ascript/instructions.h"
+#include "ascript/array.h"
+#include "ascript/structure.h"
+#include "ascript/map.h"
+#include "ascript/string_builder.h"
+#include "ascript/run_context.h"
+#include "ascript/environment.h"
+#include "ascript/tokenizer.h"
+#include "ascript/parser.h"
+#include "ascript/stdout_out.h"
+
+//Every allocation in the program goes through here, so we can count the
+//allocations done by a given piece of code.
+static std::size_t allocation_count=0;
+
+void * operator new(
+	std::size_t _size
+) {
+
+	++allocation_count;
+	if(void * ptr=std::malloc(_size ? _size : 1)) {
+
+		return ptr;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(
+	void * _ptr
+) noexcept {
+
+	std::free(_ptr);
+}
+
+void operator delete(
+	void * _ptr,
+	std::size_t
+) noexcept {
+
+	operator delete(_ptr);
+}
+
+bool check(const std::string&, std::size_t, std::size_t);
+
+//Host that provides nothing, the scripts here do not need it.
+class empty_host:
+	public ascript::host {
+
+	public:
+
+	bool                host_has(const std::string) const {return false;}
+	void                host_delete(const std::string) {}
+	ascript::variable   host_get(const std::string) const {return false;}
+	ascript::variable   host_query(const std::vector<ascript::variable>&) const {return false;}
+	void                host_add(const std::string&, ascript::variable) {}
+	void                host_set(const std::string&, ascript::variable) {}
+	void                host_do(const std::vector<ascript::variable>&) {}
+};
+
+//A short script with no strings: declarations, a loop, a branch and a call.
+static const std::string script=R"(
+beginfunction twice [n as int];
+	let result be add [n, n];
+	return [result];
+endfunction;
+beginfunction trigger [limit as int];
+	let total be 0;
+	let i be 0;
+	loop;
+		if is_equal [i, limit];
+			break;
+		endif;
+		let doubled be twice [i];
+		set total to add [total, doubled];
+		set i to add [i, 1];
+	endloop;
+	return [total];
+endfunction;
+beginfunction pick_line [line as string];
+	return [line];
+endfunction;
+beginfunction dialogue [text as string, repeats as int];
+	let said be "";
+	let i be 0;
+	loop;
+		if is_equal [i, repeats];
+			break;
+		endif;
+		set said to pick_line [text];
+		set i to add [i, 1];
+	endloop;
+	return [said];
+endfunction;
+beginfunction item [items as array, index as int];
+	let value be array_get [items, index];
+	return [value];
+endfunction;
+beginfunction sum_items [items as array];
+	let total be 0;
+	let i be 0;
+	let size be array_size [items];
+	loop;
+		if is_equal [i, size];
+			break;
+		endif;
+		let value be item [items, i];
+		set total to add [total, value];
+		set i to add [i, 1];
+	endloop;
+	return [total];
+endfunction;
+)";
+
+//Runs the function and returns how many allocations it did.
+template<typename T>
+std::size_t count_allocations(
+	T _fn
+) {
+
+	std::size_t before=allocation_count;
+	_fn();
+	return allocation_count-before;
+}
+
+bool check(
+	const std::string& _name,
+	std::size_t _allocations,
+	std::size_t _expected
+) {
+
+	std::cout<<_name<<": "<<_allocations<<" allocations, expected "<<_expected;
+	std::cout<<(_allocations==_expected ? " [ok]" : " [failed]")<<std::endl;
+	return _allocations==_expected;
+}
+
+int main(
+	int ,
+	char **
+) {
+
+	ascript::symbol_table symbol_table;
+	symbol_table.insert("i", ascript::variable{1});
+	symbol_table.insert("limit", ascript::variable{10});
+	symbol_table.insert("text", ascript::variable{"a string long enough to live on the heap"});
+
+	ascript::run_context context{nullptr, nullptr};
+	context.symbol_table=&symbol_table;
+
+	bool result=true;
+
+	//is_lesser_than [i, limit];
+	ascript::instruction_is_lesser_than lesser_than{1};
+	lesser_than.arguments.push_back({"i", ascript::variable::types::symbol});
+	lesser_than.arguments.push_back({"limit", ascript::variable::types::symbol});
+
+	result=check(
+		"is_lesser_than [i, limit]",
+		count_allocations([&]() {lesser_than.run(context);}),
+		0
+	) && result;
+
+	if(context.value.type!=ascript::variable::types::boolean || !context.value.get_bool()) {
+
+		std::cout<<"is_lesser_than [i, limit] gave the wrong result [failed]"<<std::endl;
+		result=false;
+	}
+
+	//is_equal [text, text, text];
+	ascript::instruction_is_equal is_equal{2};
+	is_equal.arguments.push_back({"text", ascript::variable::types::symbol});
+	is_equal.arguments.push_back({"text", ascript::variable::types::symbol});
+	is_equal.arguments.push_back({"text", ascript::variable::types::symbol});
+
+	result=check(
+		"is_equal [text, text, text]",
+		count_allocations([&]() {is_equal.run(context);}),
+		0
+	) && result;
+
+	//add [i, limit, 3];
+	ascript::instruction_add add{3};
+	add.arguments.push_back({"i", ascript::variable::types::symbol});
+	add.arguments.push_back({"limit", ascript::variable::types::symbol});
+	add.arguments.push_back({3});
+
+	result=check(
+		"add [i, limit, 3]",
+		count_allocations([&]() {add.run(context);}),
+		0
+	) && result;
+
+	//clamp [i, 3, limit];
+	ascript::instruction_clamp clamp{3};
+	clamp.arguments.push_back({"i", ascript::variable::types::symbol});
+	clamp.arguments.push_back({3});
+	clamp.arguments.push_back({"limit", ascript::variable::types::symbol});
+
+	result=check(
+		"clamp [i, 3, limit]",
+		count_allocations([&]() {clamp.run(context);}),
+		0
+	) && result;
+
+	//concatenate [text, text, ...] builds the result with one allocation.
+	ascript::instruction_concatenate concatenate{4};
+	for(int i=0; i<50; i++) {
+		concatenate.arguments.push_back({"text", ascript::variable::types::symbol});
+	}
+
+	result=check(
+		"concatenate [50 x text]",
+		count_allocations([&]() {concatenate.run(context);}),
+		1
+	) && result;
+
+	//String built-ins only allocate for results too long to fit inline.
+	ascript::instruction_string_find string_find{5};
+	string_find.arguments.push_back({"text", ascript::variable::types::symbol});
+	string_find.arguments.push_back({"heap"});
+
+	ascript::instruction_substring substring{5};
+	substring.arguments.push_back({"text", ascript::variable::types::symbol});
+	substring.arguments.push_back({2});
+	substring.arguments.push_back({8});
+
+	ascript::instruction_to_string to_string{5};
+	to_string.arguments.push_back({"limit", ascript::variable::types::symbol});
+
+	result=check(
+		"string_find, substring and to_string [text, limit]",
+		count_allocations([&]() {string_find.run(context); substring.run(context); to_string.run(context);}),
+		0
+	) && result;
+
+	if(context.value.get_string()!="10") {
+
+		std::cout<<"to_string [limit] gave the wrong result [failed]"<<std::endl;
+		result=false;
+	}
+
+	//format measures its result first and allocates it once.
+	ascript::instruction_format format{6};
+	format.arguments.push_back({"{}: {} of {}"});
+	format.arguments.push_back({"text", ascript::variable::types::symbol});
+	format.arguments.push_back({"i", ascript::variable::types::symbol});
+	format.arguments.push_back({"limit", ascript::variable::types::symbol});
+
+	result=check(
+		"format [\"{}: {} of {}\", text, i, limit]",
+		count_allocations([&]() {format.run(context);}),
+		1
+	) && result;
+
+	//Builders keep their memory once frozen, so building the same string 
+	//again does not allocate but for the frozen copy.
+	symbol_table.insert("log", ascript::variable{ascript::string_builder{}});
+
+	ascript::instruction_builder_append builder_append{7};
+	builder_append.arguments.push_back({"log", ascript::variable::types::symbol});
+	builder_append.arguments.push_back({"text", ascript::variable::types::symbol});
+	builder_append.arguments.push_back({"limit", ascript::variable::types::symbol});
+
+	ascript::instruction_builder_freeze builder_freeze{8};
+	builder_freeze.arguments.push_back({"log", ascript::variable::types::symbol});
+
+	builder_append.run(context);
+	builder_freeze.run(context);
+
+	result=check(
+		"builder_append and builder_freeze [log, text, limit]",
+		count_allocations([&]() {builder_append.run(context); builder_freeze.run(context);}),
+		1
+	) && result;
+
+	//Struct fields are read and written by index, resolved beforehand.
+	const auto point=std::make_shared<const ascript::struct_type>(
+		ascript::struct_type{"point", {{"x", ascript::parameter::types::integer}}}
+	);
+	symbol_table.insert("origin", ascript::variable{point});
+
+	ascript::instruction_struct_set struct_set{5, point, 0};
+	struct_set.arguments.push_back({"origin", ascript::variable::types::symbol});
+	struct_set.arguments.push_back({"limit", ascript::variable::types::symbol});
+
+	ascript::instruction_struct_get struct_get{6, point, 0};
+	struct_get.arguments.push_back({"origin", ascript::variable::types::symbol});
+
+	result=check(
+		"struct_set and struct_get [origin, point.x]",
+		count_allocations([&]() {struct_set.run(context); struct_get.run(context);}),
+		0
+	) && result;
+
+	if(context.value.get_int()!=10) {
+
+		std::cout<<"struct_get [origin, point.x] gave the wrong result [failed]"<<std::endl;
+		result=false;
+	}
+
+	//Map lookups probe a flat table, with no copies of the key.
+	ascript::map weights;
+	for(int i=0; i<100; i++) {
+		weights.set(i, i*10);
+	}
+	weights.set(ascript::variable{"a string long enough to live on the heap"}, 1);
+	symbol_table.insert("weights", ascript::variable{std::move(weights)});
+
+	ascript::instruction_map_get map_get{7};
+	map_get.arguments.push_back({"weights", ascript::variable::types::symbol});
+	map_get.arguments.push_back({"text", ascript::variable::types::symbol});
+	map_get.arguments.push_back({0});
+
+	result=check(
+		"map_get [weights, text, 0]",
+		count_allocations([&]() {map_get.run(context);}),
+		0
+	) && result;
+
+	if(context.value.get_int()!=1) {
+
+		std::cout<<"map_get [weights, text, 0] gave the wrong result [failed]"<<std::endl;
+		result=false;
+	}
+
+	//Long strings are shared between copies, short ones are inline.
+	const ascript::variable long_text{"a string too long to be stored inline"};
+	result=check(
+		"copies of a long and a short string",
+		count_allocations([&]() {
+			ascript::variable copy{long_text}, other{"short"};
+			other=copy;
+		}),
+		0
+	) && result;
+
+	//Once pooled interpreters are warm, running a script is free.
+	empty_host host;
+	ascript::stdout_out outfacility;
+	ascript::environment env(host, outfacility);
+
+	ascript::tokenizer tk;
+	ascript::parser p;
+	for(auto& s : p.parse(tk.from_string(script))) {
+		env.load(s);
+	}
+
+	const std::vector<ascript::variable> arguments{10};
+	for(int i=0; i<4; i++) {
+		env.run("trigger", arguments);
+	}
+
+	ascript::variable total{0};
+	result=check(
+		"environment run of trigger [10]",
+		count_allocations([&]() {total=env.run("trigger", arguments).get();}),
+		0
+	) && result;
+
+	if(total.get_int()!=90 || !env.get_stats().pool.hits) {
+
+		std::cout<<"environment run of trigger [10] gave the wrong result [failed]"<<std::endl;
+		result=false;
+	}
+
+	//Long strings move through arguments, symbols and returns by reference.
+	const std::vector<ascript::variable> dialogue_arguments{
+		std::string(1000, 'x'),
+		10
+	};
+
+	for(int i=0; i<4; i++) {
+		env.run("dialogue", dialogue_arguments);
+	}
+
+	ascript::variable said{false};
+	result=check(
+		"environment run of dialogue [text, 10]",
+		count_allocations([&]() {said=env.run("dialogue", dialogue_arguments).get();}),
+		0
+	) && result;
+
+	if(said.get_string().size()!=1000) {
+
+		std::cout<<"environment run of dialogue [text, 10] gave the wrong result [failed]"<<std::endl;
+		result=false;
+	}
+
+	//Arrays are passed around by handle, their elements are never copied.
+	ascript::array numbers;
+	for(int i=0; i<100; i++) {
+		numbers.push(i);
+	}
+
+	const std::vector<ascript::variable> sum_arguments{ascript::variable{std::move(numbers)}};
+	for(int i=0; i<4; i++) {
+		env.run("sum_items", sum_arguments);
+	}
+
+	ascript::variable sum{0};
+	result=check(
+		"environment run of sum_items [100 integers]",
+		count_allocations([&]() {sum=env.run("sum_items", sum_arguments).get();}),
+		0
+	) && result;
+
+	if(sum.get_int()!=4950) {
+
+		std::cout<<"environment run of sum_items [100 integers] gave the wrong result [failed]"<<std::endl;
+		result=false;
+	}
+
+	return result ? 0 : 1;
+}
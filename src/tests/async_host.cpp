@@ -0,0 +1,192 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ascript/tokenizer.h"
+#include "ascript/parser.h"
+#include "ascript/environment.h"
+#include "ascript/pending_query.h"
+#include "ascript/stdout_out.h"
+
+//Stand-in for a host whose queries go to a database or to a pathfinding 
+//worker: each async query is answered by a worker thread after a fixed 
+//latency, with its first argument doubled. Queries in flight overlap.
+class slow_host:
+	public ascript::host {
+
+	public:
+
+	                    slow_host(std::chrono::milliseconds _latency):latency{_latency}, worker{[this]() {work();}} {}
+
+	                    ~slow_host() {
+
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			stopping=true;
+		}
+
+		wake.notify_one();
+		worker.join();
+	}
+
+	bool                host_has(const std::string) const {return false;}
+	void                host_delete(const std::string) {}
+	ascript::variable   host_get(const std::string) const {return false;}
+	void                host_add(const std::string&, ascript::variable) {}
+	void                host_set(const std::string&, ascript::variable) {}
+	void                host_do(const std::vector<ascript::variable>&) {}
+
+	//The synchronous version blocks for the whole latency.
+	ascript::variable   host_query(const std::vector<ascript::variable>& _args) const {
+
+		std::this_thread::sleep_for(latency);
+		return _args.at(0).get_int()*2;
+	}
+
+	std::shared_ptr<ascript::pending_query> host_query_async(const std::vector<ascript::variable>& _args) const {
+
+		auto query=std::make_shared<ascript::pending_query>();
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			jobs.push({std::chrono::steady_clock::now()+latency, _args.at(0).get_int()*2, query});
+		}
+
+		wake.notify_one();
+		return query;
+	}
+
+	private:
+
+	struct job {
+
+		std::chrono::steady_clock::time_point ready;
+		std::int64_t        value;
+		std::shared_ptr<ascript::pending_query> query;
+
+		bool                operator>(const job& _other) const {return ready > _other.ready;}
+	};
+
+	void                work() {
+
+		std::unique_lock<std::mutex> lock{mutex};
+		while(!stopping) {
+
+			if(jobs.empty()) {
+
+				wake.wait(lock);
+				continue;
+			}
+
+			if(jobs.top().ready > std::chrono::steady_clock::now()) {
+
+				wake.wait_until(lock, jobs.top().ready);
+				continue;
+			}
+
+			auto current=jobs.top();
+			jobs.pop();
+			lock.unlock();
+			current.query->complete(current.value);
+			lock.lock();
+		}
+	}
+
+	std::chrono::milliseconds latency;
+	mutable std::mutex  mutex;
+	mutable std::condition_variable wake;
+	mutable std::priority_queue<job, std::vector<job>, std::greater<job>> jobs;
+	bool                stopping{false};
+	std::thread         worker;
+};
+
+//Each script asks the host three times, once with each kind of query.
+static const std::string script=R"(
+beginfunction sync_entity [n as int];
+	let a be host_query [n];
+	let b be host_query [a];
+	let c be host_query [b];
+	return [c];
+endfunction;
+
+beginfunction async_entity [n as int];
+	let a be host_query_async [n];
+	let b be host_query_async [a];
+	let c be host_query_async [b];
+	return [c];
+endfunction;
+)";
+
+int main(
+	int _argc,
+	char ** _argv
+) {
+
+	const std::size_t population=_argc > 1 ? std::stoul(_argv[1]) : 100;
+	const std::chrono::milliseconds latency{_argc > 2 ? std::stoi(_argv[2]) : 10};
+
+	slow_host host{latency};
+	ascript::stdout_out outfacility;
+	ascript::environment env(host, outfacility);
+
+	ascript::tokenizer tk;
+	ascript::parser p;
+	for(auto& s : p.parse(tk.from_string(script))) {
+		env.load(s);
+	}
+
+	//Blocking queries: every script waits for each of its queries in turn.
+	auto start=std::chrono::steady_clock::now();
+	for(std::size_t i=0; i<population; i++) {
+
+		env.run("sync_entity", {(int)i});
+	}
+
+	auto ms=std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-start);
+	std::cout<<population<<" scripts with blocking queries took "<<ms.count()<<"ms"<<std::endl;
+
+	//Async queries: scripts wait without blocking the thread, so the queries
+	//of all of them are in flight at once.
+	start=std::chrono::steady_clock::now();
+	for(std::size_t i=0; i<population; i++) {
+
+		env.run("async_entity", {(int)i});
+	}
+
+	std::size_t finished=0;
+	bool correct=true;
+	while(env.size()) {
+
+		for(const auto& resumed : env.resume_completed()) {
+
+			if(resumed.error.size()) {
+
+				correct=false;
+				++finished;
+			}
+			else if(!resumed.result.is_yield()) {
+
+				++finished;
+				correct=correct && resumed.result.get().get_int() % 8==0;
+			}
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+	}
+
+	ms=std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-start);
+	std::cout<<finished<<" scripts with async queries took "<<ms.count()<<"ms"<<std::endl;
+
+	if(!correct || finished!=population) {
+
+		std::cout<<"wrong results [failed]"<<std::endl;
+		return 1;
+	}
+
+	std::cout<<"results match [ok]"<<std::endl;
+	return 0;
+}
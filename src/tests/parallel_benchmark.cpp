@@ -0,0 +1,103 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "ascript/tokenizer.h"
+#include "ascript/parser.h"
+#include "ascript/parallel_environment.h"
+#include "ascript/stdout_out.h"
+
+//Host that provides nothing, the benchmarked script does not need it. It has
+//no state, so it is thread-safe.
+class empty_host:
+	public ascript::host {
+
+	public:
+
+	bool                host_has(const std::string) const {return false;}
+	void                host_delete(const std::string) {}
+	ascript::variable   host_get(const std::string) const {return false;}
+	ascript::variable   host_query(const std::vector<ascript::variable>&) const {return false;}
+	void                host_add(const std::string&, ascript::variable) {}
+	void                host_set(const std::string&, ascript::variable) {}
+	void                host_do(const std::vector<ascript::variable>&) {}
+};
+
+//Each entity does some busy work per tick for a number of ticks.
+static const std::string script=R"(
+beginfunction entity [ticks as int];
+	let tick be 0;
+	let total be 0;
+	loop;
+		if is_equal [tick, ticks];
+			break;
+		endif;
+		let i be 0;
+		loop;
+			if is_equal [i, 100];
+				break;
+			endif;
+			set total to add [total, i];
+			set i to add [i, 1];
+		endloop;
+		set tick to add [tick, 1];
+		yield;
+	endloop;
+	return [total];
+endfunction;
+)";
+
+int main(
+	int _argc,
+	char ** _argv
+) {
+
+	const std::size_t population=_argc > 1 ? std::stoul(_argv[1]) : 20000,
+	                  ticks=_argc > 2 ? std::stoul(_argv[2]) : 10,
+	                  max_workers=_argc > 3 ? std::stoul(_argv[3]) : std::thread::hardware_concurrency();
+
+	empty_host host;
+	ascript::stdout_out outfacility;
+
+	double single_worker_ms=0.;
+	for(std::size_t workers=1; workers<=std::max<std::size_t>(1, max_workers); workers*=2) {
+
+		ascript::parallel_environment env(host, outfacility, workers);
+
+		ascript::tokenizer tk;
+		ascript::parser p;
+		for(auto& s : p.parse(tk.from_string(script))) {
+			env.load(s);
+		}
+
+		for(std::size_t i=0; i<population; i++) {
+
+			env.spawn("entity", {(int)ticks});
+		}
+
+		std::size_t finished=0;
+		const auto start=std::chrono::steady_clock::now();
+		while(env.size()) {
+
+			const auto tick=env.run_all_ready();
+			finished+=tick.finished.size();
+			if(tick.failed.size()) {
+
+				std::cout<<"script failed: "<<tick.failed.front().error<<" [failed]"<<std::endl;
+				return 1;
+			}
+		}
+
+		const double ms=std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count();
+		if(1==workers) {
+
+			single_worker_ms=ms;
+		}
+
+		std::cout<<workers<<" workers: "<<finished<<" scripts in "<<ms<<"ms, speedup "<<single_worker_ms/ms<<std::endl;
+	}
+
+	return 0;
+}
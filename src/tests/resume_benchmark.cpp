@@ -0,0 +1,101 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "ascript/tokenizer.h"
+#include "ascript/parser.h"
+#include "ascript/environment.h"
+#include "ascript/stdout_out.h"
+
+//Host that provides nothing, the benchmarked script does not need it.
+class empty_host:
+	public ascript::host {
+
+	public:
+
+	bool                host_has(const std::string) const {return false;}
+	void                host_delete(const std::string) {}
+	ascript::variable   host_get(const std::string) const {return false;}
+	ascript::variable   host_query(const std::vector<ascript::variable>&) const {return false;}
+	void                host_add(const std::string&, ascript::variable) {}
+	void                host_set(const std::string&, ascript::variable) {}
+	void                host_do(const std::vector<ascript::variable>&) {}
+};
+
+//Each entity counts how many times it was resumed.
+static const std::string script=R"(
+beginfunction entity;
+	let i be 0;
+	loop;
+		yield;
+		set i to add [i, 1];
+	endloop;
+endfunction;
+)";
+
+int main(
+	int _argc,
+	char ** _argv
+) {
+
+	const std::size_t population=_argc > 1 ? std::stoul(_argv[1]) : 100000,
+	                  resumes=_argc > 2 ? std::stoul(_argv[2]) : 1000000;
+
+	empty_host host;
+	ascript::stdout_out outfacility;
+	ascript::environment env(host, outfacility);
+
+	ascript::tokenizer tk;
+	ascript::parser p;
+	for(auto& s : p.parse(tk.from_string(script))) {
+		env.load(s);
+	}
+
+	std::vector<std::size_t> ids;
+	ids.reserve(population);
+
+	auto start=std::chrono::steady_clock::now();
+	for(std::size_t i=0; i<population; i++) {
+
+		std::size_t id=0;
+		env.run("entity", {}, id);
+		ids.push_back(id);
+	}
+
+	auto elapsed=std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-start);
+	std::cout<<"started "<<population<<" interpreters in "<<elapsed.count()<<"ms"<<std::endl;
+
+	std::mt19937 generator{1234};
+	std::uniform_int_distribution<std::size_t> distribution{0, population-1};
+
+	start=std::chrono::steady_clock::now();
+	for(std::size_t i=0; i<resumes; i++) {
+
+		env.resume(ids[distribution(generator)]);
+	}
+
+	auto ns=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start);
+	std::cout<<resumes<<" random resumes took "<<ns.count()/1000000<<"ms, "<<ns.count()/resumes<<"ns per resume"<<std::endl;
+
+	//Ids of removed interpreters must not reach the ones that take their slot.
+	const auto stale_id=ids.front();
+	env.clear();
+
+	std::size_t new_id=0;
+	env.run("entity", {}, new_id);
+
+	try {
+
+		env.resume(stale_id);
+		std::cout<<"stale id "<<stale_id<<" reached interpreter "<<new_id<<" [failed]"<<std::endl;
+		return 1;
+	}
+	catch(std::exception& e) {
+
+		std::cout<<"stale id rejected: "<<e.what()<<" [ok]"<<std::endl;
+	}
+
+	return 0;
+}